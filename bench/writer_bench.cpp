@@ -0,0 +1,319 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Writer throughput benchmark.
+// Serializes a set of synthetic datasets into each supported sink and reports
+// MB/s, ns per written value and heap allocations per run.
+// Usage: writer_bench [min_seconds_per_case]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "../src/writer/writer.h"
+#include "../src/writer/async_ostream.h"
+
+namespace
+{
+    std::atomic<size_t> allocations{ 0 };
+}
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* r = std::malloc(size ? size : 1))
+        return r;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace
+{
+    using std::string;
+    using std::vector;
+    using reactive_json::writer;
+
+    /// Unbuffered-by-iostream sink that writes to a file descriptor through its own buffer.
+    class fd_streambuf : public std::streambuf
+    {
+    public:
+        explicit fd_streambuf(int fd) : fd(fd), buffer(1 << 16) {
+            setp(buffer.data(), buffer.data() + buffer.size());
+        }
+        ~fd_streambuf() { sync(); }
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (sync() != 0)
+                return traits_type::eof();
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+        int sync() override {
+            auto size = pptr() - pbase();
+#ifdef _WIN32
+            bool ok = size == 0 || _write(fd, pbase(), unsigned(size)) == size;
+#else
+            bool ok = size == 0 || ::write(fd, pbase(), size) == size;
+#endif
+            setp(buffer.data(), buffer.data() + buffer.size());
+            return ok ? 0 : -1;
+        }
+
+    private:
+        int fd;
+        vector<char> buffer;
+    };
+
+    /// Sink that writes into a preallocated fixed-size memory block.
+    class fixed_streambuf : public std::streambuf
+    {
+    public:
+        fixed_streambuf(char* data, size_t size) : data(data), size(size) { rewind(); }
+        void rewind() { setp(data, data + size); }
+
+    private:
+        char* data;
+        size_t size;
+    };
+
+    struct point { double x, y; };
+    struct polygon {
+        string name;
+        bool is_active;
+        vector<point> points;
+    };
+
+    struct dataset {
+        const char* name;
+        size_t values;  // number of scalar values (or nodes for nesting) written per run
+        std::function<void(writer&)> write;
+    };
+
+    vector<dataset> make_datasets()
+    {
+        vector<dataset> r;
+        const size_t n = 1 << 18;
+
+        auto ints = std::make_shared<vector<double>>();
+        for (size_t i = 0; i < n; i++)
+            ints->push_back(double(int(i * 2654435761u) >> 8));
+        r.push_back({ "integers", n, [=](writer& w) {
+            w.write_array(ints->size(), [&](auto& w, size_t i) { w((*ints)[i]); });
+        } });
+
+        auto doubles = std::make_shared<vector<double>>();
+        for (size_t i = 0; i < n; i++)
+            doubles->push_back((double(i * 2654435761u % 1000003) - 500000) / 7.3e3);
+        r.push_back({ "doubles", n, [=](writer& w) {
+            w.write_array(doubles->size(), [&](auto& w, size_t i) { w((*doubles)[i]); });
+        } });
+
+        auto short_strings = std::make_shared<vector<string>>();
+        for (size_t i = 0; i < n; i++)
+            short_strings->push_back("item_" + std::to_string(i % 9973));
+        r.push_back({ "short strings", n, [=](writer& w) {
+            w.write_array(short_strings->size(), [&](auto& w, size_t i) { w(std::string_view((*short_strings)[i])); });
+        } });
+
+        auto escaped_strings = std::make_shared<vector<string>>();
+        for (size_t i = 0; i < n / 4; i++)
+            escaped_strings->push_back("line\t\"" + std::to_string(i) + "\"\r\n\\path\\to\x01\x1f");
+        r.push_back({ "escape-heavy strings", n / 4, [=](writer& w) {
+            w.write_array(escaped_strings->size(), [&](auto& w, size_t i) { w(std::string_view((*escaped_strings)[i])); });
+        } });
+
+        const size_t depth = 500, repeats = 256;
+        // Each repeat writes `depth` nested arrays around one number.
+        r.push_back({ "deep nesting", repeats * (depth + 1), [=](writer& w) {
+            std::function<void(writer&, size_t)> nest = [&](writer& w, size_t level) {
+                if (level == 0)
+                    w(1.0);
+                else
+                    w.write_array(1, [&](auto& w, size_t) { nest(w, level - 1); });
+            };
+            w.write_array(repeats, [&](auto& w, size_t) { nest(w, depth); });
+        } });
+
+        const size_t width = 100, objects = n / width;
+        auto field_names = std::make_shared<vector<string>>();
+        for (size_t i = 0; i < width; i++)
+            field_names->push_back("field_" + std::to_string(i));
+        r.push_back({ "wide objects", width * objects, [=](writer& w) {
+            w.write_array(objects, [&](auto& w, size_t obj) {
+                w.write_object([&](auto fields) {
+                    for (size_t i = 0; i < width; i++)
+                        fields(field_names->at(i).c_str(), double(obj + i));
+                });
+            });
+        } });
+
+        auto polygons = std::make_shared<vector<polygon>>();
+        size_t polygon_values = 0;
+        for (size_t i = 0; i < n / 16; i++) {
+            polygons->push_back({ "polygon " + std::to_string(i), i % 3 == 0, {} });
+            for (size_t j = 0; j < 6; j++)
+                polygons->back().points.push_back({ double(i + j), double(i) - double(j) * 0.5 });
+            polygon_values += 2 + 6 * 2;
+        }
+        r.push_back({ "readme polygons", polygon_values, [=](writer& w) {
+            w.write_array(polygons->size(), [&](auto& w, size_t index) {
+                w.write_object([&poly = (*polygons)[index]](auto fields) {
+                    fields("name", std::string_view(poly.name))
+                          ("active", poly.is_active);
+                    fields.write_array("points", poly.points.size(), [&](auto& w, size_t index) {
+                        w.write_object([&pt = poly.points[index]](auto fields) {
+                            fields("x", pt.x)("y", pt.y);
+                        });
+                    });
+                });
+            });
+        } });
+        return r;
+    }
+
+    struct sink {
+        const char* name;
+        std::function<std::ostream&()> begin_run;  // prepares and returns the stream for one run
+        std::function<void()> end_run;
+    };
+
+    struct measurement {
+        size_t runs = 0;
+        double best_seconds = 0;
+        size_t allocations_per_run = 0;  // averaged over all runs
+    };
+
+    measurement measure(const dataset& data, sink& out, double min_seconds)
+    {
+        using clock = std::chrono::steady_clock;
+        measurement m;
+        auto started = clock::now();
+        size_t total_allocations = 0;
+        do {
+            auto& stream = out.begin_run();
+            size_t allocs_before = allocations.load(std::memory_order_relaxed);
+            auto t0 = clock::now();
+            {
+                writer w(stream);
+                data.write(w);
+            }
+            stream.flush();
+            double seconds = std::chrono::duration<double>(clock::now() - t0).count();
+            total_allocations += allocations.load(std::memory_order_relaxed) - allocs_before;
+            out.end_run();
+            if (m.runs++ == 0 || seconds < m.best_seconds)
+                m.best_seconds = seconds;
+        } while (std::chrono::duration<double>(clock::now() - started).count() < min_seconds);
+        m.allocations_per_run = (total_allocations + m.runs / 2) / m.runs;
+        return m;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double min_seconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+    auto datasets = make_datasets();
+
+    // Output sizes are needed to size the fixed buffer and to report MB/s.
+    vector<size_t> sizes;
+    size_t max_size = 0;
+    for (auto& d : datasets) {
+        std::ostringstream s;
+        writer w(s);
+        d.write(w);
+        sizes.push_back(s.str().size());
+        max_size = std::max(max_size, sizes.back());
+    }
+
+    std::ofstream file_stream;
+    std::ostringstream string_stream;
+#ifdef _WIN32
+    int null_fd = _open("NUL", _O_WRONLY | _O_BINARY);
+#else
+    int null_fd = open("/dev/null", O_WRONLY);
+#endif
+    fd_streambuf fd_buf(null_fd);
+    std::ostream fd_stream(&fd_buf);
+    std::unique_ptr<reactive_json::async_ostream> async_stream;
+    vector<char> fixed_block(max_size + 1);
+    fixed_streambuf fixed_buf(fixed_block.data(), fixed_block.size());
+    std::ostream fixed_stream(&fixed_buf);
+
+#ifdef _WIN32
+    const char* null_file = "NUL";
+#else
+    const char* null_file = "/dev/null";
+#endif
+    vector<sink> sinks = {
+        { "ostream", [&]() -> std::ostream& {
+            file_stream.open(null_file, std::ios::binary);
+            return file_stream;
+        }, [&] { file_stream.close(); } },
+        { "string", [&]() -> std::ostream& {
+            string_stream.str(string());
+            return string_stream;
+        }, [] {} },
+        { "fd", [&]() -> std::ostream& { return fd_stream; }, [] {} },
+        { "async fd", [&]() -> std::ostream& {
+            async_stream = std::make_unique<reactive_json::async_ostream>(fd_stream);
+            return *async_stream;
+        }, [&] { async_stream.reset(); } },
+        { "fixed buffer", [&]() -> std::ostream& {
+            fixed_buf.rewind();
+            fixed_stream.clear();
+            return fixed_stream;
+        }, [] {} },
+    };
+
+    std::printf("%-22s %-13s %10s %10s %12s %8s\n", "dataset", "sink", "bytes", "MB/s", "ns/value", "allocs");
+    for (size_t i = 0; i < datasets.size(); i++) {
+        for (auto& s : sinks) {
+            auto m = measure(datasets[i], s, min_seconds);
+            std::printf("%-22s %-13s %10zu %10.1f %12.2f %8zu\n",
+                datasets[i].name,
+                s.name,
+                sizes[i],
+                sizes[i] / m.best_seconds / 1e6,
+                m.best_seconds * 1e9 / datasets[i].values,
+                m.allocations_per_run);
+        }
+    }
+#ifdef _WIN32
+    _close(null_fd);
+#else
+    close(null_fd);
+#endif
+    return 0;
+}
@@ -0,0 +1,573 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_CONSTEXPR_READER_H
+#define REACTIVE_JSON_CONSTEXPR_READER_H
+
+#include <cfloat>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace reactive_json
+{
+    /// Reads JSON from a string literal (or any `std::string_view`) in a `constexpr` context.
+    /// It has the same query methods as `memory_block_reader`, but it is made of `constexpr` code only:
+    /// - strings are returned as views of the parsed data, so strings with escapes are not supported,
+    /// - field names are passed to `on_field` as `std::string_view`,
+    /// - errors are reported as static `const char*` texts,
+    /// - skipped elements can have at most `max_skip_depth` nesting levels.
+    /// With `expect_success` malformed JSON parsed at compile time becomes a compilation error.
+    /// Example:
+    /// constexpr std::array<int, 3> ports = [] {
+    ///     constexpr_reader json(R"-({"ports": [80, 443, 8080]})-");
+    ///     std::array<int, 3> r{};
+    ///     size_t i = 0;
+    ///     json.get_object([&](auto name) {
+    ///         if (name == "ports")
+    ///             json.get_array([&] { r[i++ % r.size()] = int(json.get_number(0)); });
+    ///     });
+    ///     json.expect_success();
+    ///     return r;
+    /// }();
+    class constexpr_reader
+    {
+    public:
+        static constexpr size_t max_skip_depth = 64;
+
+        constexpr constexpr_reader(std::string_view data)
+            : data(data)
+        {
+            skip_ws();
+        }
+
+        // Checks if passing ended successfully.
+        constexpr bool success() const { return pos == data.size() && !error_text; }
+
+        /// Throws `std::invalid_argument` if the parsing failed or the data was not read to the end.
+        /// Throwing is not allowed in constant evaluation, so at compile time this is a compilation error.
+        constexpr void expect_success() const
+        {
+            if (!success())
+                throw std::invalid_argument(error_text ? error_text : "unexpected data at the end");
+        }
+
+        /// Attempts to extract a number from the current position.
+        /// Returns nullopt and leaves the position intact if it is not a number.
+        /// The result is the nearest `double` (ties to even), as with `std::from_chars`, for numbers
+        /// having up to `max_number_digits` significant digits; further digits are only checked for zero.
+        /// Nonzero numbers out of the `double` range, both too big and too small, are "numeric overflow" errors.
+        constexpr std::optional<double> try_number()
+        {
+            auto c = peek();
+            if (c != '-' && !is_digit(c))
+                return std::nullopt;
+            bool is_negative = c == '-';
+            if (is_negative)
+                pos++;
+            decimal number;
+            if (!digits(number, false))
+                return std::nullopt;
+            if (peek() == '.') {
+                pos++;
+                if (!digits(number, true))
+                    return std::nullopt;
+            }
+            if (peek() == 'e' || peek() == 'E') {
+                pos++;
+                bool is_negative_exponent = peek() == '-';
+                if (is_negative_exponent || peek() == '+')
+                    pos++;
+                int e = 0;
+                if (!is_digit(peek())) {
+                    set_error("expected exponent");
+                    return std::nullopt;
+                }
+                for (; is_digit(peek()); pos++)
+                    e = e < 10000 ? e * 10 + (peek() - '0') : e;
+                number.exponent += is_negative_exponent ? -e : e;
+            }
+            std::optional<double> r = 0.0;
+            if (number.digit_count != 0) {
+                r = to_double(number);
+                if (!r || *r == 0) {
+                    set_error("numeric overflow");
+                    return std::nullopt;
+                }
+            }
+            skip_ws();
+            return is_negative ? -*r : *r;
+        }
+
+        /// Extracts a number from the current position.
+        /// On failure returns the `default_val`.
+        /// Always skips the current element.
+        constexpr double get_number(double default_val)
+        {
+            auto r = try_number();
+            return r ? *r : (skip_value(), default_val);
+        }
+
+        /// Attempts to extract a boolean value from the current position.
+        constexpr std::optional<bool> try_bool()
+        {
+            if (is("false"))
+                return false;
+            if (is("true"))
+                return true;
+            return std::nullopt;
+        }
+
+        /// Extracts a boolean value from the current position.
+        /// On failure returns the `default_val`.
+        /// Always skips the current element.
+        constexpr bool get_bool(bool default_val)
+        {
+            auto r = try_bool();
+            return r ? *r : (skip_value(), default_val);
+        }
+
+        /// Checks if the current position contains `null`.
+        /// If it does, skips it and returns true.
+        constexpr bool get_null() { return is("null"); }
+
+        /// Attempts to extract the string from the current position as a view of the parsed data.
+        /// Returns nullopt and leaves the position intact if it is not a string.
+        /// Strings with escapes switch the reader to the error state.
+        constexpr std::optional<std::string_view> try_string()
+        {
+            if (peek() != '"')
+                return std::nullopt;
+            size_t start = ++pos;
+            for (;; pos++) {
+                if (pos == data.size()) {
+                    set_error("incomplete string");
+                    return std::string_view();
+                }
+                if (data[pos] == '\\') {
+                    set_error("escapes are not supported by constexpr_reader");
+                    return std::string_view();
+                }
+                if (data[pos] == '"')
+                    break;
+            }
+            auto r = data.substr(start, pos - start);
+            pos++;
+            skip_ws();
+            return r;
+        }
+
+        /// Extracts the string from the current position.
+        /// If current position doesn't contain a string, returns the `default_val`.
+        /// Always skips the current element.
+        constexpr std::string_view get_string(std::string_view default_val)
+        {
+            auto r = try_string();
+            return r ? *r : (skip_value(), default_val);
+        }
+
+        /// Attempts to extract an array from the current position, see `memory_block_reader::try_array`.
+        template<typename ON_ITEM>
+        constexpr bool try_array(ON_ITEM on_item)
+        {
+            if (!is('['))
+                return false;
+            if (is(']') || error_text)
+                return true;
+            do
+                on_item();
+            while (is(','));
+            if (!is(']'))
+                set_error("expected ',' or ']'");
+            return true;
+        }
+
+        /// Extracts an array from the current position, see `memory_block_reader::get_array`.
+        template<typename ON_ITEM>
+        constexpr void get_array(ON_ITEM on_item)
+        {
+            if (!try_array(on_item))
+                skip_value();
+        }
+
+        /// Attempts to extract an object from the current position, see `memory_block_reader::try_object`.
+        /// The `on_field` handler receives the field name as `std::string_view`.
+        /// Fields not read by `on_field` are skipped.
+        template<typename ON_FIELD>
+        constexpr bool try_object(ON_FIELD on_field)
+        {
+            if (!is('{'))
+                return false;
+            if (is('}') || error_text)
+                return true;
+            do {
+                auto name = try_string();
+                if (!name) {
+                    set_error("expected field name");
+                    return true;
+                }
+                if (!is(':')) {
+                    set_error("expected ':'");
+                    return true;
+                }
+                auto value_start = pos;
+                on_field(*name);
+                if (pos == value_start)
+                    skip_value();
+            } while (is(','));
+            if (!is('}'))
+                set_error("expected ',' or '}'");
+            return true;
+        }
+
+        /// Extracts an object from the current position, see `memory_block_reader::get_object`.
+        template<typename ON_FIELD>
+        constexpr void get_object(ON_FIELD on_field)
+        {
+            if (!try_object(on_field))
+                skip_value();
+        }
+
+        /// Sets error state.
+        /// It can be called from any `on_field` / `on_item` handlers, to terminate parsing.
+        /// The `text` must outlive the reader, use string literals.
+        constexpr void set_error(const char* text)
+        {
+            if (!error_text) {
+                error_text = text;
+                error_pos = pos;
+                pos = data.size();
+            }
+        }
+
+        // Returns error offset in the parsed data, or 0 if there is no error.
+        constexpr size_t get_error_pos() const { return error_pos; }
+
+        // Returns error text or an empty string if no error.
+        constexpr const char* get_error_message() const { return error_text ? error_text : ""; }
+
+    private:
+        static constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+        constexpr char peek() const { return pos < data.size() ? data[pos] : 0; }
+
+        static constexpr int max_number_digits = 768;
+
+        // Unsigned integer of a fixed capacity, big enough to convert any `decimal` exactly.
+        struct big_uint
+        {
+            static constexpr size_t capacity = 128;
+
+            constexpr big_uint(uint32_t value = 0)
+            {
+                words[0] = value;
+                size = value ? 1 : 0;
+            }
+
+            constexpr size_t bit_length() const
+            {
+                if (size == 0)
+                    return 0;
+                size_t r = size * 32;
+                for (uint32_t top = words[size - 1]; !(top & 0x80000000u); top <<= 1)
+                    r--;
+                return r;
+            }
+
+            constexpr bool is_zero_below(size_t bit) const
+            {
+                for (size_t i = 0; i < bit / 32; i++) {
+                    if (words[i])
+                        return false;
+                }
+                return bit % 32 == 0 || !(words[bit / 32] & ((1u << bit % 32) - 1));
+            }
+
+            // Returns 64 bits starting from the `bit`.
+            constexpr uint64_t bits_from(size_t bit) const
+            {
+                uint64_t r = 0;
+                for (size_t i = 64; i-- > 0;) {
+                    size_t b = bit + i;
+                    r = r << 1 | (b / 32 < size ? words[b / 32] >> b % 32 & 1 : 0);
+                }
+                return r;
+            }
+
+            constexpr void multiply_add(uint32_t multiplier, uint32_t addend)
+            {
+                uint64_t carry = addend;
+                for (size_t i = 0; i < size; i++) {
+                    carry += uint64_t(words[i]) * multiplier;
+                    words[i] = uint32_t(carry);
+                    carry >>= 32;
+                }
+                if (carry)
+                    words[size++] = uint32_t(carry);
+            }
+
+            constexpr void multiply_pow10(int power)
+            {
+                for (; power >= 9; power -= 9)
+                    multiply_add(1000000000, 0);
+                uint32_t multiplier = 1;
+                for (; power > 0; power--)
+                    multiplier *= 10;
+                multiply_add(multiplier, 0);
+            }
+
+            constexpr void shift_left(size_t bits)
+            {
+                size_t word_shift = bits / 32;
+                unsigned bit_shift = bits % 32;
+                for (size_t i = size + word_shift + 1; i-- > 0;) {
+                    uint64_t v = i >= word_shift && i - word_shift < size ? words[i - word_shift] : 0;
+                    if (bit_shift && i > word_shift)
+                        v = v << bit_shift | words[i - word_shift - 1] >> (32 - bit_shift);
+                    else
+                        v <<= bit_shift;
+                    words[i] = uint32_t(v);
+                }
+                size += word_shift + 1;
+                trim();
+            }
+
+            constexpr void shift_right_1()
+            {
+                for (size_t i = 0; i < size; i++)
+                    words[i] = words[i] >> 1 | (i + 1 < size ? words[i + 1] << 31 : 0);
+                trim();
+            }
+
+            constexpr bool operator>=(const big_uint& b) const
+            {
+                if (size != b.size)
+                    return size > b.size;
+                for (size_t i = size; i-- > 0;) {
+                    if (words[i] != b.words[i])
+                        return words[i] > b.words[i];
+                }
+                return true;
+            }
+
+            // Requires `*this >= b`.
+            constexpr void subtract(const big_uint& b)
+            {
+                int64_t borrow = 0;
+                for (size_t i = 0; i < size; i++) {
+                    int64_t v = int64_t(words[i]) - (i < b.size ? b.words[i] : 0) - borrow;
+                    borrow = v < 0;
+                    words[i] = uint32_t(v + (borrow << 32));
+                }
+                trim();
+            }
+
+            constexpr void trim()
+            {
+                while (size && !words[size - 1])
+                    size--;
+            }
+
+            uint32_t words[capacity]{};
+            size_t size = 0;
+        };
+
+        // Number being parsed: `mantissa` * 10^`exponent`.
+        struct decimal
+        {
+            big_uint mantissa;
+            int exponent = 0;
+            int digit_count = 0;  // significant digits in the `mantissa`
+            bool is_truncated = false;  // nonzero digits beyond `max_number_digits` were dropped
+        };
+
+        // Appends decimal digits to the `number`.
+        constexpr bool digits(decimal& number, bool is_fraction)
+        {
+            if (!is_digit(peek())) {
+                set_error("expected digit");
+                return false;
+            }
+            for (; is_digit(peek()); pos++) {
+                uint32_t d = peek() - '0';
+                if (number.digit_count < max_number_digits) {
+                    if (number.digit_count || d) {
+                        number.mantissa.multiply_add(10, d);
+                        number.digit_count++;
+                    }
+                    number.exponent -= is_fraction;
+                } else {
+                    number.is_truncated |= d != 0;
+                    number.exponent += !is_fraction;
+                }
+            }
+            return true;
+        }
+
+        // Returns the `double` nearest to the nonzero `number`, 0 on underflow or nullopt on overflow.
+        // Takes the 64 leading bits of the exact binary value, and rounds them to the precision of the result.
+        static constexpr std::optional<double> to_double(decimal number)
+        {
+            // The number is in [10^(digit_count + exponent - 1), 10^(digit_count + exponent)).
+            if (number.digit_count + number.exponent > 309)
+                return std::nullopt;
+            if (number.digit_count + number.exponent < -323)
+                return 0;
+            big_uint& value = number.mantissa;
+            uint64_t bits = 0;  // the number is (`bits` + `is_inexact` * fraction) * 2^`bits_exponent`
+            int bits_exponent = 0;
+            bool is_inexact = number.is_truncated;
+            if (number.exponent >= 0) {
+                value.multiply_pow10(number.exponent);
+                size_t length = value.bit_length();
+                if (length > 64) {
+                    bits_exponent = int(length - 64);
+                    is_inexact |= !value.is_zero_below(length - 64);
+                }
+                bits = value.bits_from(bits_exponent);
+            } else {
+                big_uint divisor(1);
+                divisor.multiply_pow10(-number.exponent);
+                // Aligns the operands for a quotient in [2^62, 2^64).
+                int shift = int(divisor.bit_length()) + 63 - int(value.bit_length());
+                if (shift > 0)
+                    value.shift_left(shift);
+                else
+                    divisor.shift_left(-shift);
+                bits_exponent = -shift;
+                divisor.shift_left(63);
+                for (int i = 63; i >= 0; i--, divisor.shift_right_1()) {
+                    if (value >= divisor) {
+                        value.subtract(divisor);
+                        bits |= uint64_t(1) << i;
+                    }
+                }
+                is_inexact |= value.size != 0;
+            }
+            int length = 64;
+            while (!(bits >> (length - 1) & 1))
+                length--;
+            int top_exponent = length - 1 + bits_exponent;
+            if (top_exponent > DBL_MAX_EXP - 1)
+                return std::nullopt;
+            int precision = DBL_MANT_DIG - (top_exponent < DBL_MIN_EXP - 1 ? DBL_MIN_EXP - 1 - top_exponent : 0);
+            int drop = length - precision;
+            if (drop > 64)
+                return 0;
+            if (drop > 0) {
+                uint64_t rest = drop == 64 ? bits : bits & ((uint64_t(1) << drop) - 1);
+                uint64_t half = uint64_t(1) << (drop - 1);
+                bits = drop == 64 ? 0 : bits >> drop;
+                bits_exponent += drop;
+                if (rest > half || (rest == half && (is_inexact || (bits & 1))))
+                    bits++;
+                if (bits >> DBL_MANT_DIG && top_exponent == DBL_MAX_EXP - 1)
+                    return std::nullopt;
+            }
+            // Exact, as `bits` has at most `DBL_MANT_DIG` significant bits and each step stays in range.
+            double r = double(bits);
+            for (; bits_exponent >= 32; bits_exponent -= 32)
+                r *= 4294967296.0;
+            for (; bits_exponent <= -32; bits_exponent += 32)
+                r /= 4294967296.0;
+            for (; bits_exponent > 0; bits_exponent--)
+                r *= 2;
+            for (; bits_exponent < 0; bits_exponent++)
+                r /= 2;
+            return r;
+        }
+
+        constexpr void skip_ws()
+        {
+            while (pos < data.size() && (unsigned char)data[pos] <= ' ')
+                pos++;
+        }
+
+        constexpr bool is(char term)
+        {
+            if (peek() != term)
+                return false;
+            pos++;
+            skip_ws();
+            return true;
+        }
+
+        constexpr bool is(std::string_view term)
+        {
+            if (data.substr(pos, term.size()) != term)
+                return false;
+            pos += term.size();
+            skip_ws();
+            return true;
+        }
+
+        // Skips the string after its opening quote.
+        constexpr void skip_string()
+        {
+            for (; pos < data.size(); pos++) {
+                if (data[pos] == '\\')
+                    pos++;
+                else if (data[pos] == '"') {
+                    pos++;
+                    return;
+                }
+            }
+            set_error("incomplete string while skipping");
+        }
+
+        constexpr void skip_value()
+        {
+            auto c = peek();
+            if (c == '"') {
+                pos++;
+                skip_string();
+            } else if (c == '[' || c == '{') {
+                char expects[max_skip_depth]{};
+                size_t depth = 0;
+                while (pos < data.size() && !error_text) {
+                    c = data[pos++];
+                    if (c == '"') {
+                        skip_string();
+                    } else if (c == '[' || c == '{') {
+                        if (depth == max_skip_depth) {
+                            set_error("max depth exceeded");
+                            return;
+                        }
+                        expects[depth++] = c == '[' ? ']' : '}';
+                    } else if (c == ']' || c == '}') {
+                        if (expects[depth - 1] != c) {
+                            set_error(c == ']' ? "mismatched ]" : "mismatched }");
+                            return;
+                        }
+                        if (--depth == 0)
+                            break;
+                    }
+                }
+                if (depth != 0)
+                    set_error(expects[0] == '}' ? "incomplete object" : "incomplete array");
+            } else {
+                for (; c == '-' || c == '+' || c == '.' || is_digit(c) || (c >= 'a' && c <= 'z'); c = peek())
+                    pos++;
+            }
+            skip_ws();
+        }
+
+        std::string_view data;
+        size_t pos = 0;
+        size_t error_pos = 0;
+        const char* error_text = nullptr;
+    };
+}
+
+#endif  // REACTIVE_JSON_CONSTEXPR_READER_H
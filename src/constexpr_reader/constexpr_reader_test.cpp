@@ -0,0 +1,128 @@
+#include <array>
+#include <cfloat>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include "constexpr_reader.h"
+#include "gunit.h"
+
+namespace
+{
+    struct server_config
+    {
+        std::string_view name;
+        double timeout = 0;
+        bool is_secure = false;
+        std::array<int, 3> ports{};
+    };
+
+    constexpr server_config parse_config(std::string_view text)
+    {
+        reactive_json::constexpr_reader json(text);
+        server_config r;
+        size_t port = 0;
+        json.get_object([&](auto name) {
+            if (name == "name")
+                r.name = json.get_string("");
+            else if (name == "timeout")
+                r.timeout = json.get_number(0);
+            else if (name == "secure")
+                r.is_secure = json.get_bool(false);
+            else if (name == "ports")
+                json.get_array([&] {
+                    if (port == r.ports.size())
+                        json.set_error("too many ports");
+                    else
+                        r.ports[port++] = int(json.get_number(0));
+                });
+        });
+        json.expect_success();
+        return r;
+    }
+
+    constexpr auto config = parse_config(R"-({
+        "name": "main",
+        "limits": {"depth": [[1], {"x": "]}"}], "off": null},
+        "timeout": 2.5e-1,
+        "secure": true,
+        "ports": [80, 443, 8080]
+    })-");
+    static_assert(config.name == "main");
+    static_assert(config.timeout == 0.25);
+    static_assert(config.is_secure);
+    static_assert(config.ports[2] == 8080);
+
+    constexpr double parse_number(std::string_view text)
+    {
+        reactive_json::constexpr_reader json(text);
+        double r = json.get_number(-1);
+        json.expect_success();
+        return r;
+    }
+
+    static_assert(parse_number("0e999") == 0);
+    static_assert(parse_number("-0.000e-999") == 0);
+    static_assert(parse_number("1.7976931348623157e308") == DBL_MAX);
+    static_assert(parse_number("2.2250738585072014e-308") == DBL_MIN);
+    static_assert(parse_number("4.9406564584124654e-324") == DBL_TRUE_MIN);
+    static_assert(parse_number("2.2250738585072011e-308") == 0x0.fffffffffffffp-1022);
+    static_assert(parse_number("9007199254740993") == 9007199254740992.0);
+    static_assert(parse_number("0.1000000000000000055511151231257827021181583404541015625") == 0.1);
+    static_assert(parse_number("1.00000000000000011102230246251565404236316680908203125") == 1.0);
+    static_assert(parse_number("1.00000000000000011102230246251565404236316680908203126") == 0x1.0000000000001p0);
+    static_assert(parse_number("123456789012345678901234567890") == 123456789012345678901234567890.0);
+
+    TEST(ConstexprReader, CompileTimeConfig)
+    {
+        ASSERT_EQ(config.ports[1], 443);
+        ASSERT_EQ(config.timeout, 0.25);
+    }
+
+    TEST(ConstexprReader, Errors)
+    {
+        auto error = [](std::string_view text) {
+            reactive_json::constexpr_reader json(text);
+            json.get_array([&] { json.get_number(0); });
+            return std::string_view(json.get_error_message());
+        };
+        ASSERT_EQ(error("[1, 2]"), "");
+        ASSERT_EQ(error("[1, 2"), "expected ',' or ']'");
+        ASSERT_EQ(error("[1, -x]"), "expected digit");
+        ASSERT_EQ(error("[1, [2}]"), "mismatched }");
+        ASSERT_EQ(error("[\"a\\\"\"]"), "");
+        ASSERT_EQ(error("[1.8e308]"), "numeric overflow");
+        ASSERT_EQ(error("[1e-400]"), "numeric overflow");
+        ASSERT_EQ(error("[1e]"), "expected exponent");
+        for (auto text : { "-x", "1.", "1e", "1e400" }) {
+            reactive_json::constexpr_reader json(text);
+            ASSERT_TRUE(!json.try_number());
+        }
+        bool is_thrown = false;
+        try {
+            parse_config(R"-({"ports": [1, 2, 3, 4]})-");
+        } catch (const std::invalid_argument& e) {
+            is_thrown = std::string_view(e.what()) == "too many ports";
+        }
+        ASSERT_TRUE(is_thrown);
+    }
+
+    TEST(ConstexprReader, NumbersMatchStrtod)
+    {
+        std::mt19937 random(1);
+        for (int i = 0; i < 20000; i++) {
+            std::string text = std::to_string(random() % 10);
+            for (auto length = random() % 30; length--;)
+                text += char('0' + random() % 10);
+            if (text.size() > 1)
+                text.insert(1 + random() % (text.size() - 1), ".");
+            text += "e" + std::to_string(int(random() % 660) - 340);
+            double expected = std::strtod(text.c_str(), nullptr);
+            if (expected == 0 || expected > DBL_MAX)
+                continue;
+            reactive_json::constexpr_reader json(text);
+            auto r = json.try_number();
+            ASSERT_TRUE(r && *r == expected);
+        }
+    }
+}
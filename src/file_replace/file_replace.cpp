@@ -0,0 +1,51 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "file_replace.h"
+
+namespace reactive_json
+{
+    std::string temp_file_name(const std::string& file_name)
+    {
+        static std::atomic<unsigned> counter{ 0 };
+#ifdef _WIN32
+        auto pid = _getpid();
+#else
+        auto pid = getpid();
+#endif
+        return file_name + "." + std::to_string(pid) + "." + std::to_string(counter++) + ".tmp";
+    }
+
+    bool replace_file(const std::string& temp_name, const std::string& file_name)
+    {
+#ifdef _WIN32
+        // `std::rename` fails on Windows if the target exists.
+        return MoveFileExA(temp_name.c_str(), file_name.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        return std::rename(temp_name.c_str(), file_name.c_str()) == 0;
+#endif
+    }
+}
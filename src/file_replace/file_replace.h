@@ -0,0 +1,32 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+#ifndef REACTIVE_JSON_FILE_REPLACE_H
+#define REACTIVE_JSON_FILE_REPLACE_H
+
+#include <string>
+
+namespace reactive_json
+{
+    /// Returns a name for a temporary file next to the `file_name`, unique among processes and threads.
+    /// Savers write the new content there and `replace_file` it over the old one,
+    /// so readers never see a file cut or incomplete.
+    std::string temp_file_name(const std::string& file_name);
+
+    /// Replaces the `file_name` with the `temp_name` in one step.
+    /// Returns false on failure, on Windows also while the `file_name` is open or mapped.
+    bool replace_file(const std::string& temp_name, const std::string& file_name);
+}
+
+#endif  // REACTIVE_JSON_FILE_REPLACE_H
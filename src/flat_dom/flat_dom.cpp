@@ -0,0 +1,238 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../file_replace/file_replace.h"
+#include "flat_dom.h"
+
+namespace reactive_json
+{
+    namespace
+    {
+        const char flat_dom_magic[8] = { 'R', 'J', 'F', 'L', 'A', 'T', 'D', 'M' };
+        const uint32_t flat_dom_version = 1;
+        const uint64_t byte_order_mark = 0x0102030405060708;
+
+        std::string_view key_of(const char* image, const flat_dom_entry& entry)
+        {
+            return std::string_view(image + entry.key_offset, entry.key_size);
+        }
+    }
+
+    flat_node flat_node::operator[] (size_t index) const
+    {
+        return get_type() == flat_dom_type::array && index < slot->size
+            ? flat_node(image, (const flat_dom_slot*)(image + slot->payload) + index)
+            : flat_node();
+    }
+
+    flat_node flat_node::operator() (std::string_view key) const
+    {
+        if (get_type() != flat_dom_type::object)
+            return flat_node();
+        auto begin = entries(), end = begin + slot->size;
+        auto it = std::lower_bound(begin, end, key, [&](const flat_dom_entry& e, std::string_view key) {
+            return key_of(image, e) < key;
+        });
+        return it != end && key_of(image, *it) == key
+            ? flat_node(image, &it->value)
+            : flat_node();
+    }
+
+    std::string_view flat_node::as_str(std::string_view default_value) const
+    {
+        return get_type() == flat_dom_type::string
+            ? std::string_view(image + slot->payload, slot->size)
+            : default_value;
+    }
+
+    bool flat_node::as_bool(bool default_value) const
+    {
+        return get_type() == flat_dom_type::bool_value ? slot->size != 0 : default_value;
+    }
+
+    double flat_node::as_num(double default_value) const
+    {
+        if (get_type() != flat_dom_type::number)
+            return default_value;
+        double r;
+        std::memcpy(&r, &slot->payload, sizeof(double));
+        return r;
+    }
+
+    size_t flat_node::size() const
+    {
+        auto type = get_type();
+        return type == flat_dom_type::array || type == flat_dom_type::object ? slot->size : 0;
+    }
+
+    std::string_view flat_node::get_key(size_t index) const
+    {
+        return get_type() == flat_dom_type::object && index < slot->size
+            ? key_of(image, entries()[index])
+            : std::string_view();
+    }
+
+    flat_node flat_node::get_value(size_t index) const
+    {
+        return get_type() == flat_dom_type::object && index < slot->size
+            ? flat_node(image, &entries()[index].value)
+            : flat_node();
+    }
+
+    uint32_t flat_dom_builder::checked_size(size_t size)
+    {
+        if (size > 0xffffffff)
+            is_too_big = true;
+        return uint32_t(size);
+    }
+
+    uint64_t flat_dom_builder::append(const void* data, size_t size)
+    {
+        uint64_t r = image.size();
+        image.append((const char*)data, size);
+        image.resize((image.size() + 7) & ~size_t(7));
+        return r;
+    }
+
+    void flat_dom_builder::sort_fields(std::vector<flat_dom_entry>& fields)
+    {
+        std::stable_sort(fields.begin(), fields.end(), [&](const flat_dom_entry& a, const flat_dom_entry& b) {
+            return key_of(image.data(), a) < key_of(image.data(), b);
+        });
+    }
+
+    void flat_dom_builder::finish(const flat_dom_slot& root)
+    {
+        flat_dom_header header{};
+        std::memcpy(header.magic, flat_dom_magic, sizeof(header.magic));
+        header.version = flat_dom_version;
+        header.byte_order = byte_order_mark;
+        header.size = image.size();
+        header.root = root;
+        std::memcpy(&image[0], &header, sizeof(header));
+    }
+
+    bool flat_dom_builder::save(const std::string& file_name) const
+    {
+        if (image.empty())
+            return false;
+        // Truncating the file in place would cut it under the processes that map it (SIGBUS on access),
+        // so the image is written to a unique temporary file and renamed over the old one.
+        std::string temp_name = temp_file_name(file_name);
+        {
+            std::ofstream out(temp_name, std::ios::binary | std::ios::trunc);
+            out.write(image.data(), image.size());
+            if (!out.flush()) {
+                out.close();
+                std::remove(temp_name.c_str());
+                return false;
+            }
+        }
+        // Fails on Windows while the old file is mapped.
+        bool is_replaced = replace_file(temp_name, file_name);
+        if (!is_replaced)
+            std::remove(temp_name.c_str());
+        return is_replaced;
+    }
+
+    bool flat_dom::open(const std::string& file_name)
+    {
+        close();
+        const char* mapped = nullptr;
+        size_t mapped_size = 0;
+#ifdef _WIN32
+        HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER file_size;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+            if (HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+                mapped = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                mapped_size = size_t(file_size.QuadPart);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                mapped = (const char*)p;
+                mapped_size = size_t(st.st_size);
+            }
+        }
+        ::close(fd);
+#endif
+        if (!mapped)
+            return false;
+        if (!attach(mapped, mapped_size)) {
+#ifdef _WIN32
+            UnmapViewOfFile(mapped);
+#else
+            munmap((void*)mapped, mapped_size);
+#endif
+            return false;
+        }
+        is_mapped = true;
+        return true;
+    }
+
+    bool flat_dom::attach(const char* data, size_t size)
+    {
+        close();
+        auto header = (const flat_dom_header*)data;
+        if (!data
+            || size < sizeof(flat_dom_header)
+            || reinterpret_cast<uintptr_t>(data) % alignof(flat_dom_header) != 0
+            || std::memcmp(header->magic, flat_dom_magic, sizeof(header->magic)) != 0
+            || header->version != flat_dom_version
+            || header->byte_order != byte_order_mark
+            || header->size != size)
+            return false;
+        this->data = data;
+        this->size = size;
+        return true;
+    }
+
+    void flat_dom::close()
+    {
+        if (is_mapped) {
+#ifdef _WIN32
+            UnmapViewOfFile(data);
+#else
+            munmap((void*)data, size);
+#endif
+        }
+        data = nullptr;
+        size = 0;
+        is_mapped = false;
+    }
+}
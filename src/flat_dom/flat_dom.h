@@ -0,0 +1,217 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_FLAT_DOM_H
+#define REACTIVE_JSON_FLAT_DOM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace reactive_json
+{
+    /// Flat DOM is a read-only JSON document model stored in one contiguous memory block (an image) that contains offsets instead of pointers.
+    /// The image is built once by `flat_dom_builder` and then it can be used at any address:
+    /// saved to a file and mapped by `flat_dom::open` in many processes, placed in shared memory, or sent over the network.
+    /// All processes mapping the same file share the same physical pages, so the memory use doesn't grow with the number of processes.
+    /// Image layout (all offsets are from the image start, all records are 8-byte aligned, numbers are in the native byte order):
+    /// - `flat_dom_header` with the root value,
+    /// - each value is a 16-byte `flat_dom_slot`:
+    ///   - null and bool store the value in `size`,
+    ///   - number stores a `double` in `payload`,
+    ///   - string stores the offset of its bytes,
+    ///   - array stores the offset of its item slots,
+    ///   - object stores the offset of its `flat_dom_entry` records sorted by key.
+    enum class flat_dom_type : uint32_t { null_value, bool_value, number, string, array, object };
+
+    struct flat_dom_slot
+    {
+        flat_dom_type type;
+        uint32_t size;  // bool value, string size, array and object item count
+        uint64_t payload;
+    };
+
+    struct flat_dom_entry
+    {
+        uint64_t key_offset;
+        uint32_t key_size;
+        uint32_t reserved;
+        flat_dom_slot value;
+    };
+
+    struct flat_dom_header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t byte_order;
+        uint64_t size;  // of the whole image
+        flat_dom_slot root;
+    };
+
+    /// A lightweight view of one value of a flat DOM image.
+    /// Its traversal methods match the in-process DOM from the `dom_io_test` example,
+    /// they never fail: accessing absent items, absent fields or values of other types gives a null node or the default value.
+    class flat_node
+    {
+    public:
+        flat_node() = default;
+        flat_node(const char* image, const flat_dom_slot* slot) : image(image), slot(slot) {}
+
+        flat_dom_type get_type() const { return slot ? slot->type : flat_dom_type::null_value; }
+        bool is_null() const { return get_type() == flat_dom_type::null_value; }
+
+        /// Returns the array item, or a null node.
+        flat_node operator[] (size_t array_index) const;
+
+        /// Returns the object field value, or a null node. Finds it with a binary search.
+        flat_node operator() (std::string_view object_field_key) const;
+
+        /// Returns the string value, pointing directly into the image.
+        std::string_view as_str(std::string_view default_value = "") const;
+        bool as_bool(bool default_value = false) const;
+        double as_num(double default_value = 0) const;
+
+        /// Returns the number of array items or object fields, or zero for other types.
+        size_t size() const;
+
+        /// Returns the key of the object field by its index (fields are sorted by key).
+        std::string_view get_key(size_t field_index) const;
+
+        /// Returns the value of the object field by its index.
+        flat_node get_value(size_t field_index) const;
+
+    private:
+        const flat_dom_entry* entries() const { return (const flat_dom_entry*)(image + slot->payload); }
+
+        const char* image = nullptr;
+        const flat_dom_slot* slot = nullptr;
+    };
+
+    /// Builds the flat DOM image from any reader.
+    /// Example:
+    /// memory_block_reader json(data);
+    /// flat_dom_builder builder;
+    /// if (builder.build(json) && builder.save("catalog.dom")) ...
+    class flat_dom_builder
+    {
+    public:
+        /// Reads one JSON value from the reader and makes an image of it.
+        /// Returns false if the reader ends up in the error state or if a string or container has more than 4G items.
+        /// The builder is recursive, its depth can be bounded by `reader_limits::max_depth` of the reader.
+        template<typename READER>
+        bool build(READER& json)
+        {
+            image.clear();
+            image.resize(sizeof(flat_dom_header));
+            is_too_big = false;
+            auto root = read_value(json);
+            if (is_too_big)
+                json.set_error("flat_dom size limit exceeded");
+            if (!json.get_error_message().empty()) {
+                image.clear();
+                return false;
+            }
+            finish(root);
+            return true;
+        }
+
+        const std::string& get_image() const { return image; }
+
+        /// Writes the image to a file to be opened by `flat_dom::open`. Returns false on I/O errors.
+        /// The file is replaced as a whole, so `flat_dom` instances that have the old file opened keep reading the old image.
+        /// On Windows the file can't be replaced while it is opened.
+        bool save(const std::string& file_name) const;
+
+    private:
+        template<typename READER>
+        flat_dom_slot read_value(READER& json)
+        {
+            flat_dom_slot r{};
+            if (json.get_null())
+                return r;
+            if (auto v = json.try_bool()) {
+                r.type = flat_dom_type::bool_value;
+                r.size = *v;
+            } else if (auto v = json.try_number()) {
+                r.type = flat_dom_type::number;
+                std::memcpy(&r.payload, &*v, sizeof(double));
+            } else if (json.try_string(string_buffer)) {
+                r.type = flat_dom_type::string;
+                r.size = checked_size(string_buffer.size());
+                r.payload = append(string_buffer.data(), string_buffer.size());
+            } else {
+                std::vector<flat_dom_slot> items;
+                std::vector<flat_dom_entry> fields;
+                if (json.try_array([&] { items.push_back(read_value(json)); })) {
+                    r.type = flat_dom_type::array;
+                    r.size = checked_size(items.size());
+                    r.payload = append(items.data(), items.size() * sizeof(flat_dom_slot));
+                } else if (json.try_object([&](auto name) {
+                    fields.push_back({ append(name.data(), name.size()), checked_size(name.size()), 0, {} });
+                    fields.back().value = read_value(json);
+                })) {
+                    r.type = flat_dom_type::object;
+                    r.size = checked_size(fields.size());
+                    sort_fields(fields);
+                    r.payload = append(fields.data(), fields.size() * sizeof(flat_dom_entry));
+                } else {
+                    json.set_error("unexpected node type");
+                }
+            }
+            return r;
+        }
+
+        uint32_t checked_size(size_t size);
+        uint64_t append(const void* data, size_t size);
+        void sort_fields(std::vector<flat_dom_entry>& fields);
+        void finish(const flat_dom_slot& root);
+
+        std::string image;
+        std::string string_buffer;
+        bool is_too_big = false;
+    };
+
+    /// Flat DOM image opened from a file or attached to a memory block.
+    class flat_dom
+    {
+    public:
+        flat_dom() = default;
+        flat_dom(const flat_dom&) = delete;
+        flat_dom& operator= (const flat_dom&) = delete;
+        ~flat_dom() { close(); }
+
+        /// Maps the image file read-only. The pages are shared by all processes that map this file.
+        /// Returns false if the file can't be mapped or it isn't a valid image for this platform.
+        bool open(const std::string& file_name);
+
+        /// Uses the image in an existing memory block (for example a shared memory segment), the block must outlive this object.
+        /// Returns false if the block isn't a valid image for this platform.
+        bool attach(const char* data, size_t size);
+
+        void close();
+
+        /// Returns the root value or a null node if no image is opened.
+        flat_node root() const { return data ? flat_node(data, &((const flat_dom_header*)data)->root) : flat_node(); }
+
+    private:
+        const char* data = nullptr;
+        size_t size = 0;
+        bool is_mapped = false;
+    };
+}
+
+#endif  // REACTIVE_JSON_FLAT_DOM_H
@@ -0,0 +1,110 @@
+#include <cstdio>
+#include <sstream>
+#include <memory>
+#include "flat_dom.h"
+#include "../memory_block_reader/memory_block_reader.h"
+#include "../istream_reader/istream_reader.h"
+#include "gunit.h"
+
+namespace
+{
+    const char* text = R"-([
+        {"active": false, "name": "p1", "points": [{"x": 11, "y": 32, "z": 30}, {"y": 23, "x": 12}]},
+        {"points": [], "active": true, "name": "Corner\n", "note": null}
+    ])-";
+
+    void check(reactive_json::flat_node dom)
+    {
+        ASSERT_EQ(dom.size(), 2);
+        ASSERT_EQ(dom[1]("name").as_str(), "Corner\n");
+        ASSERT_EQ(dom[0]("points")[0]("z").as_num(), 30);
+        ASSERT_EQ(dom[0]("points")[1]("x").as_num(), 12);
+        ASSERT_TRUE(dom[1]("active").as_bool());
+        ASSERT_TRUE(dom[1]("note").is_null());
+        ASSERT_TRUE(dom[1]("note").get_type() == reactive_json::flat_dom_type::null_value);
+        ASSERT_TRUE(dom[1]("absent").is_null());
+        ASSERT_EQ(dom[2]("name").as_str("none"), "none");
+        ASSERT_TRUE(dom[1]("points").get_type() == reactive_json::flat_dom_type::array);
+        ASSERT_EQ(dom[1].size(), 4);
+        ASSERT_EQ(dom[1].get_key(0), "active");
+        ASSERT_EQ(dom[1].get_key(3), "points");
+        ASSERT_EQ(dom[1].get_value(1).as_str(), "Corner\n");
+        ASSERT_EQ(dom[0]("name").as_num(-1), -1);
+    }
+
+    TEST(FlatDom, BuildAndTraverse)
+    {
+        reactive_json::memory_block_reader json(text);
+        reactive_json::flat_dom_builder builder;
+        ASSERT_TRUE(builder.build(json));
+        ASSERT_TRUE(json.success());
+        reactive_json::flat_dom dom;
+        ASSERT_TRUE(dom.attach(builder.get_image().data(), builder.get_image().size()));
+        check(dom.root());
+
+        // The image contains no pointers, so it works at another address.
+        std::vector<uint64_t> copy(builder.get_image().size() / 8);
+        std::memcpy(copy.data(), builder.get_image().data(), builder.get_image().size());
+        reactive_json::flat_dom moved;
+        ASSERT_TRUE(moved.attach((const char*)copy.data(), builder.get_image().size()));
+        check(moved.root());
+
+        reactive_json::istream_reader stream_json(std::make_unique<std::stringstream>(text));
+        reactive_json::flat_dom_builder stream_builder;
+        ASSERT_TRUE(stream_builder.build(stream_json));
+        ASSERT_TRUE(stream_builder.get_image() == builder.get_image());
+    }
+
+    TEST(FlatDom, MappedFile)
+    {
+        std::string file_name = "flat_dom_test.dom";
+        reactive_json::memory_block_reader json(text);
+        reactive_json::flat_dom_builder builder;
+        ASSERT_TRUE(builder.build(json));
+        ASSERT_TRUE(builder.save(file_name));
+        reactive_json::flat_dom first, second;
+        ASSERT_TRUE(first.open(file_name));
+        ASSERT_TRUE(second.open(file_name));
+        check(first.root());
+        check(second.root());
+        second.close();
+        ASSERT_TRUE(second.root().is_null());
+        first.close();
+        std::remove(file_name.c_str());
+        ASSERT_FALSE(first.open(file_name));
+    }
+
+#ifndef _WIN32
+    TEST(FlatDom, RebuildWhileOpened)
+    {
+        std::string file_name = "flat_dom_rebuild_test.dom";
+        reactive_json::memory_block_reader json(text);
+        reactive_json::flat_dom_builder builder;
+        ASSERT_TRUE(builder.build(json));
+        ASSERT_TRUE(builder.save(file_name));
+        reactive_json::flat_dom old_dom;
+        ASSERT_TRUE(old_dom.open(file_name));
+        auto old_root = old_dom.root();
+
+        json.reset("[\"rebuilt\"]");
+        ASSERT_TRUE(builder.build(json));
+        ASSERT_TRUE(builder.save(file_name));
+        check(old_root);
+        reactive_json::flat_dom new_dom;
+        ASSERT_TRUE(new_dom.open(file_name));
+        ASSERT_EQ(new_dom.root()[0].as_str(), "rebuilt");
+        std::remove(file_name.c_str());
+    }
+#endif
+
+    TEST(FlatDom, Errors)
+    {
+        reactive_json::memory_block_reader json(R"-({"a": [1, }])-");
+        reactive_json::flat_dom_builder builder;
+        ASSERT_FALSE(builder.build(json));
+        ASSERT_TRUE(builder.get_image().empty());
+        reactive_json::flat_dom dom;
+        std::vector<uint64_t> garbage(16);
+        ASSERT_FALSE(dom.attach((const char*)garbage.data(), garbage.size() * 8));
+    }
+}
@@ -24,6 +24,13 @@ namespace reactive_json
     {
         this->stream = std::move(stream);
         error_text.clear();
+        depth = 0;
+        allocated = 0;
+        consumed = 0;
+        error_pos = 0;
+        release_marks();
+        history.clear();
+        history_pos = 0;
         getch();
         skip_ws();
     }
@@ -57,8 +64,31 @@ namespace reactive_json
     }
 
     unsigned char istream_reader::getch() {
-        cur = (unsigned char) stream->get();
-        return stream->good() ? cur : (cur = 0);
+        if (history_pos < history.size()) {
+            cur = (unsigned char)history[history_pos++];
+        } else {
+            if (!is_recording && !history.empty()) {
+                history.clear();
+                history_pos = 0;
+            }
+            cur = (unsigned char)stream->get();
+            if (!stream->good())
+                return cur = 0;
+            if (is_recording) {
+                if (history.size() < history_limit) {
+                    history.push_back(char(cur));
+                    history_pos++;
+                } else {
+                    release_marks();
+                    is_history_lost = true;
+                }
+            }
+        }
+        if (++consumed > limits.max_document_size) {
+            set_error("document too large");
+            return cur = 0;
+        }
+        return cur;
     }
 
     double istream_reader::get_number(double default_val)
@@ -94,11 +124,20 @@ namespace reactive_json
         uint32_t code_point;
         getch();
         for (;;) {
+            if (result.size() > limits.max_string_size) {
+                set_error("string too long");
+                return true;
+            }
+            if (result.size() > limits.max_allocated - allocated) {
+                set_error("allocation limit exceeded");
+                return true;
+            }
             switch (cur) {
             case 0:
                 set_error("incomplete string");
                 return true;
             case '"':
+                allocated += result.size();
                 getch();
                 skip_ws();
                 return true;
@@ -157,84 +196,44 @@ namespace reactive_json
             : (skip_value(), std::string(default_val));
     }
 
-    void istream_reader::set_error(std::string text)
+    istream_reader::checkpoint istream_reader::mark(size_t max_buffer)
     {
-        if (error_text.empty()) {
-            error_text = std::move(text);
-            cur = 0;
+        if (!is_recording) {
+            history.erase(0, history_pos);
+            history_pos = 0;
+            history_limit = max_buffer;
+            is_recording = true;
+            is_history_lost = false;
         }
+        return { cur, consumed, history_pos, allocated, depth, !error_text.empty() };
     }
 
-    std::streamoff istream_reader::handle_object_start(std::string& field_name)
+    bool istream_reader::rewind(const checkpoint& mark)
     {
-        if (is('}')) return 0;
-        if (!handle_field_name(field_name))
-            return 0;
-        return stream->tellg();
+        if (!is_recording || is_history_lost || mark.history_pos > history.size())
+            return false;
+        cur = mark.cur;
+        consumed = mark.offset;
+        history_pos = mark.history_pos;
+        allocated = mark.allocated;
+        depth = mark.depth;
+        if (!mark.has_error)
+            error_text.clear();
+        return true;
     }
 
-    bool istream_reader::handle_object_cont(std::string& field_name, std::streamoff& start_pos)
+    void istream_reader::release_marks()
     {
-        if (stream->tellg() == start_pos)
-            skip_value();
-        if (is(',')) {
-            if (handle_field_name(field_name)) {
-                start_pos = stream->tellg();
-                return true;
-            }
-        }
-        else if (!is('}'))
-            set_error("expected ',' or '}'");
-        skip_ws_after_value();
-        return false;
+        is_recording = false;
     }
 
-    bool istream_reader::get_codepoint(uint32_t& val)
+    void istream_reader::set_error(std::string text)
     {
-        auto get_utf16 = [&] {
-            auto hex = [&] {
-                if (cur == 0) {
-                    set_error("incomplete \\uXXXX sequence");
-                    return false;
-                }
-                if (cur >= '0' && cur <= '9')
-                    val = (val << 4) | (cur - '0');
-                else if (cur >= 'a' && cur <= 'f')
-                    val = (val << 4) | (cur - 'a' + 10);
-                else if (cur >= 'A' && cur <= 'F')
-                    val = (val << 4) | (cur - 'A' + 10);
-                else {
-                    set_error("not a hex digit");
-                    return false;
-                }
-                getch();
-                return true;
-            };
-            getch();
-            return hex() && hex() && hex() && hex();
-        };
-        if (!get_utf16())
-            return false;
-        if (val >= 0xd800 && val <= 0xdbff) {
-            set_error("second surrogare without first one");
-            return false;
-        }
-        else if (val >= 0xdd00 && val <= 0xDFFF) {
-            auto first = val;
-            val = 0;
-            if (cur != '\\' || getch() != 'u') {
-                set_error("first surrogare without following \\u");
-                return false;
-            }
-            if (!get_utf16())
-                return false;
-            if (!(val >= 0xd800 && val <= 0xdbff)) {
-                set_error("first surrogare without second one");
-                return false;
-            }
-            val = ((first & 0x3ff) << 10 | (val & 0x3ff)) + 0x10000;
+        if (error_text.empty()) {
+            error_pos = consumed;
+            error_text = std::move(text);
+            cur = 0;
         }
-        return true;
     }
 
     bool istream_reader::put_utf8(size_t v, std::string& dst, size_t& left)
@@ -264,6 +263,7 @@ namespace reactive_json
             dst.push_back(char(((v >> 6) & 0x3f) | 0x80));
         }
         dst.push_back(char((v & 0x3f) | 0x80));
+        return left > 0;
     }
 
     void istream_reader::skip_ws()
@@ -304,8 +304,10 @@ namespace reactive_json
         if (!cur)
             return;
         if (cur == '{') {
+            getch();
             skip_until('}');
         } else if (cur == '[') {
+            getch();
             skip_until(']');
         } else if (cur == '"') {
             getch();
@@ -328,54 +330,6 @@ namespace reactive_json
         }
     }
 
-    void istream_reader::skip_until(char term)
-    {
-        getch();
-        std::vector<char> expects{ term };
-        while (cur) {
-            switch (cur) {
-            case'"':
-                getch();
-                skip_string();
-                continue;
-            case'[':
-                expects.push_back(']');
-                break;
-            case'{':
-                expects.push_back('}');
-                break;
-            case']':
-            case'}':
-                if (expects.empty() || expects.back() != cur) {
-                    std::string error = "mismatched }";
-                    error.back() = cur;
-                    set_error(error);
-                    return;
-                }
-                expects.pop_back();
-                if (expects.empty()) {
-                    getch();
-                    skip_ws();
-                    return;
-                }
-                break;
-            default:
-                break;
-            }
-            getch();
-        }
-        set_error(term == '}' ? "incomplete object" : "incomplete array");
-        return;
-    }
-
-    bool istream_reader::is(char term) {
-        if (cur != term)
-            return false;
-        getch();
-        skip_ws();
-        return true;
-    }
-
     bool istream_reader::is(const char* term) {
         if (cur != *term)
             return false;
@@ -391,16 +345,4 @@ namespace reactive_json
         skip_ws_after_value();
         return true;
     }
-
-    bool istream_reader::handle_field_name(std::string& field_name) {
-        if (!try_string(field_name)) {
-            set_error("expected field name");
-            return false;
-        }
-        if (!is(':')) {
-            set_error("expected ':'");
-            return false;
-        }
-        return true;
-    }
 }
@@ -15,21 +15,45 @@ limitations under the License.
 #define REACTIVE_JSON_ISTREAM_READER_H
 
 #include <istream>
+#include <memory>
 #include <optional>
 
+#include "read_ahead_istream.h"
+#include "../reader_core/reader_core.h"
+
 namespace reactive_json
 {
     /// Reads JSON from std::istream.
-    struct istream_reader
+    struct istream_reader : reader_core<istream_reader>
     {
         istream_reader(std::unique_ptr<std::istream> stream)
         {
             reset(std::move(stream));
         }
 
+        /// Constructs the reader that reads the `stream` on a background thread,
+        /// overlapping the I/O latency with parsing.
+        /// Useful for slow or spiky sources like network file systems and pipes.
+        istream_reader(std::unique_ptr<std::istream> stream, read_ahead_options read_ahead)
+        {
+            reset(std::move(stream), read_ahead);
+        }
+
         /// Prepares the reader to a new parsing session.
         void reset(std::unique_ptr<std::istream> stream);
 
+        /// Sets resource limits for this and all following parsing sessions.
+        /// The `max_document_size` limits the amount of bytes read from the stream.
+        void set_limits(const reader_limits& limits) { this->limits = limits; }
+
+        const reader_limits& get_limits() { return limits; }
+
+        /// Prepares the reader to a new parsing session with background read-ahead.
+        void reset(std::unique_ptr<std::istream> stream, read_ahead_options read_ahead)
+        {
+            reset(std::make_unique<read_ahead_istream>(std::move(stream), read_ahead));
+        }
+
         // Checks if passing ended successfully.
         bool success() { return cur == 0 && error_text.empty(); }
 
@@ -100,142 +124,84 @@ namespace reactive_json
         /// If the parsed string has errors: unterminated, bad escapes, bad utf16 surrogate pairs, `reader` switches to the error state.
         std::string get_string(const char* default_val, size_t max_size = ~0u);
 
-        /// Attempts to extract an array from the current position.
-        /// If current position contains an array:
-        /// - returns true,
-        /// - calls `on_item` for each array element.
-        /// - and advances the position.
-        /// Otherwise:
-        /// - leaves the current position intact
-        /// - returns false.
-        /// The `on_array` handler is a `void()` lambda, that is invoked on each array item.
-        /// It must call any `reader` methods to extract the array item data.
-        /// Example:
-        /// reader json("[1,2,3,4]");
-        /// std::vector<double> result;
-        /// bool it_was_array = json.try_array([&]{
-        ///     result.push_back(json.get_number(0));
-        /// });
-        /// If the array is malformed, the `reader` switches to the error state.
-        template<typename ON_ITEM>
-        bool try_array(ON_ITEM on_item)
-        {
-            if (!is('['))
-                return false;
-            if (is(']'))
-                return true;
-            do
-                on_item();
-            while (is(','));
-            if (!is(']'))
-                set_error("expected ',' or ']'");
-            skip_ws_after_value();
-            return true;
-        }
-
-        /// Extracts an array from the current position.
-        /// If the current position contains an array it calls `on_item` for each array element.
-        /// Alway skips current json element.
-        /// The `on_array` handler is a `void()` lambda, that must call any `reader` methods to extract the array item data.
-        /// Example:
-        /// reader json("[1,2,3,4]");
-        /// std::vector<double> result;
-        /// json.get_array([&]{
-        ///     result.push_back(json.get_number(0));
-        /// });
-        /// If the array is malformed, the `reader` switches to the error state.
-        template<typename ON_ITEM>
-        void get_array(ON_ITEM on_item)
-        {
-            if (!try_array(std::move(on_item)))
-                skip_value();
-        }
+        // `try_array`, `get_array`, `try_tuple`, `get_tuple`, `try_fixed_array`, `try_object` and `get_object`
+        // are inherited from `reader_core`.
 
-        /// Attempts to extract an object from the current position.
-        /// If the current position contains an object:
-        /// - returns true,
-        /// - calls `on_field` for each field.
-        /// - advances the position past the object.
-        /// Otherwise:
-        /// - leaves the current position intact
-        /// - returns false.
-        /// The `on_field` handler is a `void(std::string field_name)` lambda, that:
-        /// - receives the field name as a string,
-        /// - can use any any `reader` methods to access the field data.
-        /// Example:
-        /// reader json(R"-( { "x": 1, "y": "hello" } )-");
-        /// std::pair<double, std::string> result;
-        /// bool it_was_object = json.try_object([&] (auto name){
-        ///     if (name == "x") result.first = json.get_number(0);
-        ///     else if (name == "y") result.second = json.get_string("");
-        /// });
-        /// If the object is malformed, the `reader` switches to the error state.
-        template<typename ON_FIELD>
-        bool try_object(ON_FIELD on_field)
+        /// Saved reader state, see `mark`.
+        struct checkpoint
         {
-            if (!is('{'))
-                return false;
-            std::string field_name;
-            if (auto p = handle_object_start(field_name))
-            {
-                do
-                    on_field(std::move(field_name));
-                while (handle_object_cont(field_name, p));
-            }
-            return true;
-        }
-
-        /// Extracts an object from the current position.
-        /// If the current position contains an object, calls `on_field` for each field.
-        /// Skips current json element.
-        /// The `on_field` handler is a `void(std::string field_name)` lambda, that:
-        /// - reseives the field name as a string,
-        /// - can use any any `reader` methods to access the field data.
+            unsigned char cur;
+            size_t offset;
+            size_t history_pos;
+            size_t allocated;  // so the data read again after `rewind` isn't counted twice against `max_allocated`
+            size_t depth;
+            bool has_error;
+        };
+
+        /// Saves the current position and error state, allowing to `rewind` to it.
+        /// It allows to try alternative interpretations of the same data without intermediate DOM.
+        /// Since the stream can't seek back, the reader keeps the data read after the oldest active mark in memory,
+        /// up to `max_buffer` bytes. If more data is read, all marks become invalid.
+        /// Marks can be nested, the buffer is held until `release_marks` is called.
         /// Example:
-        /// reader json(R"-( { "x": 1, "y": "hello" } )-");
-        /// std::pair<double, std::string> result;
-        /// json.get_object([&] (auto name){
-        ///     if (name == "x") result.first = json.get_number(0);
-        ///     else if (name == "y") result.second = json.get_string("");
-        /// });
-        /// If the object is malformed, the `reader` switches to the error state.
-        template<typename ON_FIELD>
-        void get_object(ON_FIELD on_field)
-        {
-            if (!try_object(std::move(on_field)))
-                skip_value();
-        }
+        /// auto start = json.mark();
+        /// if (!try_read_circle(json, shape)) {
+        ///     json.rewind(start);
+        ///     read_polygon(json, shape);
+        /// }
+        /// json.release_marks();
+        checkpoint mark(size_t max_buffer = 1 << 16);
+
+        /// Restores the position, error state and the counted allocations saved by `mark`.
+        /// Must be called at the same nesting level (in the same `on_item`/`on_field` handler) where the mark was made.
+        /// Returns false and leaves the reader intact if the mark is no more valid.
+        bool rewind(const checkpoint& mark);
+
+        /// Invalidates all marks and stops buffering of the read data.
+        void release_marks();
 
         /// Sets error state.
         /// It can be called from any `on_field` / `on_item` handlers, to terminate parsing.
         /// In the error state, the `parser` responds nullopt/false to all calls, quits all `get/try_object/array` aggregated calls.
         void set_error(std::string text);
 
-        // Returns error position in he parsed json or nullptr is there is no error.
-        std::streamoff get_error_pos() { error_text.empty() ? std::streampos() : stream->tellg(); }
+        // Returns error position in he parsed json or 0 is there is no error.
+        std::streamoff get_error_pos() { return error_text.empty() ? 0 : std::streamoff(error_pos); }
 
         // Returns error text both set by `set_error` manually and the internal parsing errors.
         // Returns an empty string if no error.
         const std::string& get_error_message() { return error_text; }
 
     private:
-        std::streamoff handle_object_start(std::string& field_name);
-        bool handle_object_cont(std::string& field_name, std::streamoff& start_pos);
-        bool get_codepoint(uint32_t& val);
+        friend class reader_core<istream_reader>;
+        using reader_core::is;
+
+        // Input policy for `reader_core`.
+        unsigned char peek() const { return cur; }
+        void next() { getch(); }
+        size_t position() const { return consumed; }
+        bool has_error() const { return !error_text.empty(); }
+        void end_value() { skip_ws_after_value(); }
+
         bool put_utf8(size_t v, std::string& dst, size_t& left);
         void skip_ws();
         void skip_ws_after_value();
         void skip_string();
         void skip_value();
-        void skip_until(char term);
-        bool is(char term);
         bool is(const char* term);
-        bool handle_field_name(std::string& field_name);
         unsigned char istream_reader::getch();
 
         std::unique_ptr<std::istream> stream;
         unsigned char cur;
         std::string error_text;
+        size_t allocated = 0;
+        size_t consumed = 0;
+        size_t error_pos = 0;
+        std::string history;  // data read after the oldest mark
+        size_t history_pos = 0;  // position of `cur` in `history` when rewound
+        size_t history_limit = 0;
+        bool is_recording = false;
+        bool is_history_lost = false;
     };
 }
 
@@ -7,3 +7,52 @@
 #define RESET_READER(NAME, TEXT) NAME.reset(std::make_unique<std::stringstream>(TEXT))
 
 #include "reader_tests.inc"
+
+namespace
+{
+    TEST(ReactiveJsonStream, NestedMarksAndBufferLimit) {
+        reactive_json::istream_reader a(std::make_unique<std::stringstream>(R"-([1, [2, 3], "long string"])-"));
+        std::vector<double> items;
+        ASSERT_TRUE(a.try_array([&] {
+            auto outer = a.mark(8);
+            if (a.try_array([&] {
+                    auto inner = a.mark();
+                    a.get_string("");
+                    ASSERT_TRUE(a.rewind(inner));
+                    items.push_back(a.get_number(0));
+                })) {
+                ASSERT_TRUE(a.rewind(outer));
+                a.get_array([&] { items.push_back(a.get_number(0) * 10); });
+            } else if (a.try_number()) {
+                ASSERT_TRUE(a.rewind(outer));
+                items.push_back(a.get_number(0));
+            } else {
+                a.get_string("");
+                ASSERT_FALSE(a.rewind(outer)) << "string is longer than the buffer";
+            }
+            a.release_marks();
+        }));
+        ASSERT_TRUE(a.success());
+        ASSERT_EQ(items.size(), 5);
+        ASSERT_EQ(items[0], 1);
+        ASSERT_EQ(items[3], 20);
+        ASSERT_EQ(items[4], 30);
+    }
+
+    TEST(ReactiveJsonStream, RewoundAllocations) {
+        reactive_json::istream_reader a(std::make_unique<std::stringstream>(R"-(["abcdef"])-"));
+        reactive_json::reader_limits limits;
+        limits.max_allocated = 8;
+        a.set_limits(limits);
+        std::string text;
+        a.get_array([&] {
+            auto start = a.mark();
+            a.get_string("");
+            ASSERT_TRUE(a.rewind(start));
+            text = a.get_string("");
+            a.release_marks();
+        });
+        ASSERT_TRUE(a.success());
+        ASSERT_EQ(text, "abcdef");
+    }
+}
@@ -0,0 +1,106 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "read_ahead_istream.h"
+
+namespace reactive_json
+{
+    read_ahead_streambuf::read_ahead_streambuf(std::unique_ptr<std::istream> source, read_ahead_options options)
+        : source(std::move(source))
+    {
+        if (!options.buffer_count)
+            options.buffer_count = 1;
+        if (!options.buffer_size)
+            options.buffer_size = 1;
+        buffers.resize(options.buffer_count);
+        for (size_t i = 0; i < buffers.size(); i++) {
+            buffers[i].resize(options.buffer_size);
+            free_buffers.push_back(i);
+        }
+        producer = std::thread([this] { produce(); });
+    }
+
+    read_ahead_streambuf::~read_ahead_streambuf()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        has_free.notify_one();
+        producer.join();
+    }
+
+    void read_ahead_streambuf::produce()
+    {
+        for (;;) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                has_free.wait(lock, [&] { return stopping || !free_buffers.empty(); });
+                if (stopping)
+                    return;
+                index = free_buffers.front();
+                free_buffers.pop_front();
+            }
+            auto& buffer = buffers[index];
+            source->read(buffer.data(), buffer.size());
+            size_t size = size_t(source->gcount());
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                filled_buffers.push_back({ index, size });
+                if (size && !source->good())
+                    filled_buffers.push_back({ index, 0 });
+            }
+            has_filled.notify_one();
+            if (!size || !source->good())
+                return;
+        }
+    }
+
+    read_ahead_streambuf::int_type read_ahead_streambuf::underflow()
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        if (at_end)
+            return traits_type::eof();
+        filled_buffer next;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (current != ~size_t(0)) {
+                consumed += egptr() - eback();
+                free_buffers.push_back(current);
+                current = ~size_t(0);
+                has_free.notify_one();
+            }
+            has_filled.wait(lock, [&] { return !filled_buffers.empty(); });
+            next = filled_buffers.front();
+            filled_buffers.pop_front();
+        }
+        if (!next.size) {
+            at_end = true;
+            setg(nullptr, nullptr, nullptr);
+            return traits_type::eof();
+        }
+        current = next.index;
+        auto data = buffers[current].data();
+        setg(data, data, data + next.size);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    read_ahead_streambuf::pos_type read_ahead_streambuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+    {
+        if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::in))
+            return pos_type(off_type(-1));
+        return pos_type(consumed + (gptr() - eback()));
+    }
+}
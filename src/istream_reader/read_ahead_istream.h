@@ -0,0 +1,97 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_READ_AHEAD_ISTREAM_H
+#define REACTIVE_JSON_READ_AHEAD_ISTREAM_H
+
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace reactive_json
+{
+    /// Parameters of background reading.
+    struct read_ahead_options
+    {
+        /// Size of each buffer filled by one `read` from the source stream.
+        size_t buffer_size = 1 << 16;
+
+        /// Number of buffers, it limits the amount of data read in advance.
+        size_t buffer_count = 4;
+    };
+
+    /// Stream buffer that reads the source stream on a background thread.
+    /// The producer thread fills a fixed pool of buffers and passes them through
+    /// a bounded single-producer-single-consumer queue to the consumer.
+    /// So the I/O latency of the source overlaps with the processing of the previous buffers.
+    /// The queue lock is taken once per buffer, not per character.
+    /// Supports `tellg` (as a count of consumed bytes), doesn't support seeking.
+    class read_ahead_streambuf : public std::streambuf
+    {
+    public:
+        read_ahead_streambuf(std::unique_ptr<std::istream> source, read_ahead_options options = {});
+
+        /// Stops the producer thread. If it is blocked in the source `read`, waits for it to return.
+        ~read_ahead_streambuf();
+
+    protected:
+        int_type underflow() override;
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+    private:
+        struct filled_buffer {
+            size_t index;
+            size_t size;  // zero marks the end of the source
+        };
+
+        void produce();
+
+        std::unique_ptr<std::istream> source;
+        std::vector<std::vector<char>> buffers;
+        std::deque<size_t> free_buffers;
+        std::deque<filled_buffer> filled_buffers;
+        std::mutex mutex;
+        std::condition_variable has_free;
+        std::condition_variable has_filled;
+        bool stopping = false;
+        bool at_end = false;
+        size_t current = ~size_t(0);  // buffer being consumed
+        std::streamoff consumed = 0;  // bytes in all buffers before the current one
+        std::thread producer;
+    };
+
+    /// `std::istream` that reads its source on a background thread using `read_ahead_streambuf`.
+    /// Example:
+    /// istream_reader json(std::make_unique<read_ahead_istream>(
+    ///     std::make_unique<std::ifstream>("big.json", std::ios::binary)));
+    class read_ahead_istream : public std::istream
+    {
+    public:
+        read_ahead_istream(std::unique_ptr<std::istream> source, read_ahead_options options = {})
+            : std::istream(nullptr)
+            , buffer(std::move(source), options)
+        {
+            rdbuf(&buffer);
+        }
+
+    private:
+        read_ahead_streambuf buffer;
+    };
+}
+
+#endif  // REACTIVE_JSON_READ_AHEAD_ISTREAM_H
@@ -0,0 +1,9 @@
+#include <sstream>
+#include <memory>
+#include "istream_reader.h"
+
+#define GROUP_NAME ReactiveJsonReadAhead
+#define MK_READER(NAME, TEXT) reactive_json::istream_reader NAME(std::make_unique<std::stringstream>(TEXT), reactive_json::read_ahead_options{ 3, 2 })
+#define RESET_READER(NAME, TEXT) NAME.reset(std::make_unique<std::stringstream>(TEXT), reactive_json::read_ahead_options{ 3, 2 })
+
+#include "reader_tests.inc"
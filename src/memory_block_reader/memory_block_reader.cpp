@@ -15,8 +15,10 @@ limitations under the License.
 #include <bitset>
 #include <cassert>
 #include <charconv>
+#include <cstdint>
 
 #include "memory_block_reader.h"
+#include "structural_index.h"
 
 namespace reactive_json
 {
@@ -24,13 +26,25 @@ namespace reactive_json
     {
         if (!length)
             length = strlen(data);
-        pos = (const unsigned char*)data;
+        begin = pos = (const unsigned char*)data;
         end = (const unsigned char*)data + length;
+        index = nullptr;
         error_pos = nullptr;
         error_text.clear();
+        depth = 0;
+        allocated = 0;
+        if (length > limits.max_document_size)
+            set_error("document too large");
         skip_ws();
     }
 
+    void memory_block_reader::set_limits(const reader_limits& limits)
+    {
+        this->limits = limits;
+        if (size_t(end - begin) > limits.max_document_size)
+            set_error("document too large");
+    }
+
     std::optional<double> memory_block_reader::try_number()
     {
         if (pos == end)
@@ -110,6 +124,9 @@ namespace reactive_json
         pos++;
         auto p = pos;
         bool has_tail = false;
+        bool is_limited = limits.max_string_size < max_size;  // if so, any tail means an error
+        if (is_limited)
+            max_size = limits.max_string_size + 1;
         auto is_escape = [](unsigned char c) {
             static auto mask = [] {
                 std::bitset<128> r;
@@ -135,7 +152,7 @@ namespace reactive_json
                     return true;
                 }
                 if (*pos == 'u') {
-                    size_t val = 0;
+                    uint32_t val = 0;
                     if (!get_codepoint(val))
                         return true;
                     auto codepoint_size = val <= 0x7ff
@@ -159,6 +176,15 @@ namespace reactive_json
                 break;
             }
         }
+        if (is_limited && has_tail) {
+            set_error("string too long");
+            return true;
+        }
+        if (size > limits.max_allocated - allocated) {
+            set_error("allocation limit exceeded");
+            return true;
+        }
+        allocated += size;
         auto dst = allocator(size, context);
         if (!dst) {
             skip_string();
@@ -195,85 +221,142 @@ namespace reactive_json
         return true;
     }
 
-    void memory_block_reader::set_error(std::string text)
-    {
-        if (!error_pos) {
-            error_pos = pos;
-            error_text = std::move(text);
-            pos = end;
-        }
-    }
-
-    const unsigned char* memory_block_reader::handle_object_start(std::string& field_name)
+    std::string_view memory_block_reader::get_raw_value()
     {
-        if (is('}')) return nullptr;
-        if (!handle_field_name(field_name))
-            return nullptr;
-        return pos;
+        auto start = pos;
+        skip_value();
+        if (error_pos)
+            return std::string_view();
+        auto stop = pos;
+        while (stop != start && stop[-1] <= ' ')
+            stop--;
+        return std::string_view((const char*)start, stop - start);
     }
 
-    bool memory_block_reader::handle_object_cont(std::string& field_name, const unsigned char*& start_pos)
+    size_t memory_block_reader::count_array_items()
     {
-        if (pos == start_pos)
-            skip_value();
-        if (is(',')) {
-            if (handle_field_name(field_name)) {
-                start_pos = pos;
-                return true;
+        if (pos == end || *pos != '[')
+            return 0;
+        auto start = mark();
+        size_t count = 0;
+        pos++;
+        skip_ws();
+        if (pos != end && *pos != ']') {
+            size_t i = is_indexed() ? index->find(start.pos - begin) : structural_index::npos;
+            if (i != structural_index::npos) {
+                count = 1;
+                for (auto j = i + 1, close = index->pairs[i]; j < close;) {
+                    if (index->pairs[j] == structural_index::npos) {
+                        count++;
+                        j++;
+                    } else {
+                        j = index->pairs[j] + 1;
+                    }
+                }
+            } else {
+                do {
+                    skip_value();
+                    count++;
+                } while (is(',') && !error_pos);
             }
         }
-        else if (!is('}'))
-            set_error("expected ',' or '}'");
-        return false;
+        rewind(start);
+        return count;
     }
 
-    bool memory_block_reader::get_codepoint(size_t& val)
+    bool memory_block_reader::seek(std::string_view json_pointer)
     {
-        pos++;
-        auto get_utf16 = [&] {
-            auto hex = [&] {
-                if (pos == end) {
-                    set_error("incomplete \\uXXXX sequence");
-                    return false;
-                }
-                if (*pos >= '0' && *pos <= '9')
-                    val = (val << 4) | (*pos - '0');
-                else if (*pos >= 'a' && *pos <= 'f')
-                    val = (val << 4) | (*pos - 'a' + 10);
-                else if (*pos >= 'A' && *pos <= 'F')
-                    val = (val << 4) | (*pos - 'A' + 10);
-                else {
-                    set_error("not a hex digit");
-                    return false;
-                }
-                pos++;
-                return true;
-            };
-            return hex() && hex() && hex() && hex();
-        };
-        if (!get_utf16())
+        auto start = mark();
+        auto not_found = [&] {
+            if (!error_pos)
+                rewind(start);
             return false;
-        if (val >= 0xd800 && val <= 0xdbff) {
-            set_error("second surrogare without first one");
+        };
+        if (!json_pointer.empty() && json_pointer[0] != '/') {
+            set_error("invalid json pointer");
             return false;
         }
-        else if (val >= 0xdd00 && val <= 0xDFFF) {
-            auto first = val;
-            val = 0;
-            if (pos == end || *pos != '\\' || pos + 1 == end || pos[1] != 'u') {
-                set_error("first surrogare without following \\u");
-                return false;
+        std::string token, buffer;
+        std::string_view key;
+        while (!json_pointer.empty()) {
+            json_pointer.remove_prefix(1);
+            auto token_end = std::min(json_pointer.find('/'), json_pointer.size());
+            token.assign(json_pointer.data(), token_end);
+            json_pointer.remove_prefix(token_end);
+            for (size_t i = 0; (i = token.find('~', i)) != std::string::npos; i++) {
+                if (i + 1 == token.size() || (token[i + 1] != '0' && token[i + 1] != '1')) {
+                    set_error("invalid json pointer");
+                    return false;
+                }
+                token.replace(i, 2, token[i + 1] == '0' ? "~" : "/");
             }
-            pos += 2;
-            if (!get_utf16())
-                return false;
-            if (!(val >= 0xd800 && val <= 0xdbff)) {
-                set_error("first surrogare without second one");
-                return false;
+            auto container = pos;
+            if (is('{')) {
+                if (is('}'))
+                    return not_found();
+                for (;;) {
+                    if (!read_field_key(key, buffer))
+                        return false;
+                    if (key == token)
+                        break;
+                    skip_value();
+                    if (!is(',')) {
+                        if (!is('}'))
+                            set_error("expected ',' or '}'");
+                        return not_found();
+                    }
+                }
+            } else if (is('[')) {
+                size_t item = 0;
+                if (token.empty() || (token.size() > 1 && token[0] == '0'))
+                    return not_found();
+                for (auto c : token) {
+                    if (c < '0' || c > '9' || item > (SIZE_MAX - size_t(c - '0')) / 10)
+                        return not_found();
+                    item = item * 10 + (c - '0');
+                }
+                if (is(']'))
+                    return not_found();
+                size_t i = is_indexed() && item ? index->find(container - begin) : structural_index::npos;
+                if (i != structural_index::npos) {
+                    // Counts the commas of this array in the index, jumping over nested containers.
+                    size_t j = i + 1, close = index->pairs[i];
+                    for (size_t left = item; j < close;) {
+                        if (index->pairs[j] != structural_index::npos)
+                            j = index->pairs[j] + 1;
+                        else if (--left)
+                            j++;
+                        else
+                            break;
+                    }
+                    if (j >= close)
+                        return not_found();
+                    pos = begin + index->positions[j] + 1;
+                    skip_ws();
+                    continue;
+                }
+                for (; item; item--) {
+                    skip_value();
+                    if (!is(',')) {
+                        if (!is(']'))
+                            set_error("expected ',' or ']'");
+                        return not_found();
+                    }
+                }
+            } else {
+                return not_found();
             }
-            val = ((first & 0x3ff) << 10 | (val & 0x3ff)) + 0x10000;
         }
-        return true;
+        return !error_pos;
+    }
+
+    void memory_block_reader::set_error(std::string text)
+    {
+        if (!error_pos) {
+            error_pos = pos;
+            error_text = std::move(text);
+            pos = end;
+        }
     }
 
     size_t memory_block_reader::get_codepoint_no_check(const unsigned char*& pos)
@@ -342,10 +425,23 @@ namespace reactive_json
         skip_ws();
     }
 
+    bool memory_block_reader::is_indexed() const
+    {
+        return index && index->max_depth <= limits.max_depth;
+    }
+
     void memory_block_reader::skip_value()
     {
         if (pos == end)
             return;
+        if (is_indexed() && (*pos == '{' || *pos == '[')) {
+            auto i = index->find(pos - begin);
+            if (i != structural_index::npos) {
+                pos = begin + index->positions[index->pairs[i]] + 1;
+                skip_ws();
+                return;
+            }
+        }
         if (*pos == '{') {
             pos++;
             skip_until('}');
@@ -373,51 +469,6 @@ namespace reactive_json
         }
     }
 
-    void memory_block_reader::skip_until(char term)
-    {
-        std::vector<char> expects{ term };
-        while (pos != end) {
-            char c = *pos++;
-            switch (c) {
-            case'"':
-                skip_string();
-                break;
-            case'[':
-                expects.push_back(']');
-                break;
-            case'{':
-                expects.push_back('}');
-                break;
-            case']':
-            case'}':
-                if (expects.empty() || expects.back() != c) {
-                    std::string error = "mismatched }";
-                    error.back() = c;
-                    set_error(error);
-                    return;
-                }
-                expects.pop_back();
-                if (expects.empty()) {
-                    skip_ws();
-                    return;
-                }
-                break;
-            default:
-                break;
-            }
-        }
-        set_error(term == '}' ? "incomplete object" : "incomplete array");
-        return;
-    }
-
-    bool memory_block_reader::is(char term) {
-        if (pos == end || *pos != term)
-            return false;
-        pos++;
-        skip_ws();
-        return true;
-    }
-
     bool memory_block_reader::is(const char* term) {
         for (auto p = pos;; term++, p++) {
             if (!*term) {
@@ -430,15 +481,41 @@ namespace reactive_json
         }
     }
 
-    bool memory_block_reader::handle_field_name(std::string& field_name) {
-        if (!try_string(field_name)) {
+    bool memory_block_reader::read_field_key(std::string_view& key, std::string& buffer)
+    {
+        if (pos == end || *pos != '"') {
             set_error("expected field name");
             return false;
         }
+        auto key_start = pos + 1;
+        auto key_end = (const unsigned char*)memchr(key_start, '"', end - key_start);
+        if (key_end && !memchr(key_start, '\\', key_end - key_start)) {
+            if (size_t(key_end - key_start) > limits.max_string_size) {
+                set_error("string too long");
+                return false;
+            }
+            key = std::string_view((const char*)key_start, key_end - key_start);
+            pos = key_end + 1;
+            skip_ws();
+        } else {
+            try_string(buffer);
+            if (error_pos)
+                return false;
+            key = buffer;
+        }
         if (!is(':')) {
             set_error("expected ':'");
             return false;
         }
         return true;
     }
+
+    size_t memory_block_reader::handle_shape_field(object_shape& shape, size_t prev_key)
+    {
+        std::string_view key;
+        std::string buffer;
+        return read_field_key(key, buffer)
+            ? shape.find(key, prev_key)
+            : object_shape::unknown;
+    }
 }
@@ -14,13 +14,22 @@ limitations under the License.
 #ifndef REACTIVE_JSON_MEMORY_BLOCK_READER_H
 #define REACTIVE_JSON_MEMORY_BLOCK_READER_H
 
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <optional>
 
+#include "../reader_core/reader_core.h"
+#include "object_shape.h"
+
 namespace reactive_json
 {
+    struct structural_index;
+
     /// Reads JSON from preallocated fixed buffer containing the whole JSON image.
-    struct memory_block_reader
+    struct memory_block_reader : reader_core<memory_block_reader>
     {
         memory_block_reader(const char* data, size_t length = 0)
         {
@@ -28,8 +37,27 @@ namespace reactive_json
         }
 
         /// Prepares the memory_block_reader to a new parsing session.
+        /// Drops the structural index set by `set_index`, keeps the limits set by `set_limits`.
         void reset(const char* data, size_t length = 0);
 
+        /// Sets resource limits for this and all following parsing sessions.
+        /// If the current document exceeds the `max_document_size`, switches to the error state immediately.
+        void set_limits(const reader_limits& limits);
+
+        const reader_limits& get_limits() { return limits; }
+
+        /// Makes the reader skip unneeded arrays and objects in one jump using the prebuilt `index`.
+        /// The index must be successfully built for the same data block,
+        /// and it must outlive the parsing session.
+        /// Skipped elements are not validated beyond the bracket and string structure checked by the index build.
+        /// Jumps don't check the depth of skipped elements, so if the document nesting exceeds `reader_limits::max_depth`,
+        /// the index is not used and skipped elements are scanned and depth-checked.
+        /// Readers only read the index, so one index can be used by readers on any number of threads (see `shared_document`).
+        void set_index(const structural_index* index) { this->index = index; }
+
+        /// Returns true if skipping and counting use the index set by `set_index` (see `max_depth` above).
+        bool is_indexed() const;
+
         // Checks if passing ended successfully.
         bool success() {
             return pos == end && !error_pos;
@@ -124,109 +152,283 @@ namespace reactive_json
         /// the `memory_block_reader` switches to the error state and never calls the `allocator`.
         bool read_string_to_buffer(char* (*allocator)(size_t size, void* context), void* context, size_t max_size = ~0u);
 
-        /// Attempts to extract an array from the current position.
-        /// If current position contains an array:
-        /// - returns true,
-        /// - calls `on_item` for each array element.
-        /// - and advances the position.
-        /// Otherwise:
-        /// - leaves the current position intact
-        /// - returns false.
-        /// The `on_array` handler is a `void()` lambda, that is invoked on each array item.
-        /// It must call any `memory_block_reader` methods to extract the array item data.
+        /// Returns the number of items of the array at the current position, or 0 if it is not an array.
+        /// Items are skipped without decoding (or counted by jumping over the bracket pairs if `is_indexed`),
+        /// the position is left intact.
+        /// Without an index it costs one more pass over the array, and nested calls rescan inner arrays at each level,
+        /// so call it only if this pass is cheaper than growing the container.
+        /// Malformed items are counted as is, errors are reported by the subsequent parsing of this array.
+        size_t count_array_items();
+
+        /// Same as `try_array`, but before the first item it calls `on_size(size_t items)` with the number of array items,
+        /// so the destination container can be pre-sized once. See the cost of `count_array_items`.
         /// Example:
-        /// memory_block_reader json("[1,2,3,4]");
         /// std::vector<double> result;
-        /// bool it_was_array = json.try_array([&]{
-        ///     result.push_back(json.get_number(0));
-        /// });
-        /// If the array is malformed, the `memory_block_reader` switches to the error state.
-        template<typename ON_ITEM>
-        bool try_array(ON_ITEM on_item)
+        /// json.try_array_sized(
+        ///     [&](size_t size) { result.reserve(size); },
+        ///     [&] { result.push_back(json.get_number(0)); });
+        template<typename ON_SIZE, typename ON_ITEM>
+        bool try_array_sized(ON_SIZE on_size, ON_ITEM on_item)
         {
-            if (!is('['))
+            if (pos == end || *pos != '[')
                 return false;
-            if (is(']'))
-                return true;
-            do
-                on_item();
-            while (is(','));
-            if (!is(']'))
-                set_error("expected ',' or ']'");
-            return true;
+            on_size(count_array_items());
+            return try_array(std::move(on_item));
+        }
+
+        /// Same as `get_array`, but calls `on_size` with the number of array items first, see `try_array_sized`.
+        template<typename ON_SIZE, typename ON_ITEM>
+        void get_array_sized(ON_SIZE on_size, ON_ITEM on_item)
+        {
+            if (!try_array_sized(std::move(on_size), std::move(on_item)))
+                skip_value();
         }
 
-        /// Extracts an array from the current position.
-        /// If the current position contains an array it calls `on_item` for each array element.
-        /// Alway skips current json element.
-        /// The `on_array` handler is a `void()` lambda, that must call any `memory_block_reader` methods to extract the array item data.
+        /// Progress of an array parsed in slices by `try_array_slice`.
+        struct array_slice
+        {
+            bool started = false;
+            bool finished = false;
+            size_t items = 0;  // number of items handled so far
+        };
+
+        /// Attempts to extract a part of the array from the current position, allowing to interleave parsing of a big array with other work.
+        /// Calls `on_item` for array items until the array ends or more than `byte_budget` bytes are consumed in this call.
+        /// The `slice` keeps the progress between calls, start with a default-constructed one and repeat while `!slice.finished`.
+        /// Items are never interrupted: the array is suspended only between items, so each `on_item` call still parses its item completely.
+        /// Returns false and leaves the position intact if the current position doesn't contain an array, otherwise returns true.
+        /// The reader and its data must stay intact between calls.
         /// Example:
-        /// memory_block_reader json("[1,2,3,4]");
-        /// std::vector<double> result;
-        /// json.get_array([&]{
-        ///     result.push_back(json.get_number(0));
-        /// });
-        /// If the array is malformed, the `memory_block_reader` switches to the error state.
+        /// memory_block_reader::array_slice slice;
+        /// void on_tick() {
+        ///     json.try_array_slice(slice, 64 * 1024, [&]{ records.push_back(read_record(json)); });
+        ///     if (!slice.finished) schedule(on_tick);
+        /// }
         template<typename ON_ITEM>
-        void get_array(ON_ITEM on_item)
+        bool try_array_slice(array_slice& slice, size_t byte_budget, ON_ITEM on_item)
         {
-            if (!try_array(std::move(on_item)))
-                skip_value();
+            auto stop_at = size_t(end - pos) > byte_budget ? pos + byte_budget : end;
+            return try_array_slice_until(slice, on_item, [&] { return pos >= stop_at; });
         }
 
-        /// Attempts to extract an object from the current position.
-        /// If the current position contains an object:
-        /// - returns true,
-        /// - calls `on_field` for each field.
-        /// - advances the position past the object.
-        /// Otherwise:
-        /// - leaves the current position intact
-        /// - returns false.
-        /// The `on_field` handler is a `void(std::string field_name)` lambda, that:
-        /// - receives the field name as a string,
-        /// - can use any any `memory_block_reader` methods to access the field data.
+        /// Same as above, but the slice is limited by the `deadline` instead of the amount of consumed bytes.
+        template<typename ON_ITEM>
+        bool try_array_slice(array_slice& slice, std::chrono::steady_clock::time_point deadline, ON_ITEM on_item)
+        {
+            return try_array_slice_until(slice, on_item, [&] { return std::chrono::steady_clock::now() >= deadline; });
+        }
+
+        // `try_array`, `get_array`, `try_tuple`, `get_tuple`, `try_fixed_array` and the `try_object`/`get_object`
+        // overloads receiving field names are inherited from `reader_core`.
+        using reader_core::try_object;
+        using reader_core::get_object;
+
+        /// Same as `try_object`, but `on_field` receives the key id in the `shape` (or `object_shape::unknown`) instead of the name.
+        /// Keys are compared in place without extracting them to strings, and the expected key is checked first,
+        /// so records with the same field order need one key comparison per field, see `object_shape`.
         /// Example:
-        /// memory_block_reader json(R"-( { "x": 1, "y": "hello" } )-");
-        /// std::pair<double, std::string> result;
-        /// bool it_was_object = json.try_object([&] (auto name){
-        ///     if (name == "x") result.first = json.get_number(0);
-        ///     else if (name == "y") result.second = json.get_string("");
+        /// static thread_local object_shape shape{ "x", "y" };
+        /// bool it_was_object = json.try_object(shape, [&] (size_t key){
+        ///     if (key == 0) result.first = json.get_number(0);
+        ///     else if (key == 1) result.second = json.get_string("");
         /// });
-        /// If the object is malformed, the `memory_block_reader` switches to the error state.
         template<typename ON_FIELD>
-        bool try_object(ON_FIELD on_field)
+        bool try_object(object_shape& shape, ON_FIELD on_field)
         {
             if (!is('{'))
                 return false;
-            std::string field_name;
-            if (auto p = handle_object_start(field_name))
-            {
-                do
-                    on_field(std::move(field_name));
-                while (handle_object_cont(field_name, p));
-            }
+            nesting_guard nesting(*this);
+            if (is('}') || error_pos)
+                return true;
+            size_t prev_key = object_shape::unknown;
+            do {
+                auto key = handle_shape_field(shape, prev_key);
+                if (error_pos)
+                    return true;
+                if (key != object_shape::unknown)
+                    prev_key = key;
+                auto value_start = pos;
+                on_field(key);
+                if (pos == value_start)
+                    skip_value();
+            } while (is(','));
+            if (!is('}'))
+                set_error("expected ',' or '}'");
             return true;
         }
 
-        /// Extracts an object from the current position.
-        /// If the current position contains an object, calls `on_field` for each field.
-        /// Skips current json element.
-        /// The `on_field` handler is a `void(std::string field_name)` lambda, that:
-        /// - reseives the field name as a string,
-        /// - can use any any `memory_block_reader` methods to access the field data.
+        /// Same as `try_object(object_shape&, ON_FIELD)`, but it also checks the object fields:
+        /// - `required` is a bitmask of the key ids (bit N for key id N, ids above 63 are not tracked) that must be present,
+        /// - in the `strict` mode an unknown key switches the reader to the error state before its value is parsed.
+        /// Returns the bitmask of the missing required keys (zero if all are present), or nullopt if it is not an object.
         /// Example:
-        /// memory_block_reader json(R"-( { "x": 1, "y": "hello" } )-");
-        /// std::pair<double, std::string> result;
-        /// json.get_object([&] (auto name){
-        ///     if (name == "x") result.first = json.get_number(0);
-        ///     else if (name == "y") result.second = json.get_string("");
-        /// });
-        /// If the object is malformed, the `memory_block_reader` switches to the error state.
+        /// static thread_local object_shape shape{ "id", "name", "tags" };
+        /// auto missing = json.try_object(shape, 0b011, [&] (size_t key){ ... }, true);
+        /// if (missing && *missing)
+        ///     json.set_error("missing required field");
+        template<typename ON_FIELD>
+        std::optional<uint64_t> try_object(object_shape& shape, uint64_t required, ON_FIELD on_field, bool strict = false)
+        {
+            uint64_t present = 0;
+            bool is_object = try_object(shape, [&](size_t key) {
+                if (key < 64)
+                    present |= uint64_t(1) << key;
+                else if (key == object_shape::unknown && strict) {
+                    set_error("unknown field");
+                    return;
+                }
+                on_field(key);
+            });
+            if (!is_object)
+                return std::nullopt;
+            return required & ~present;
+        }
+
+        /// Same as `try_object(object_shape&, uint64_t, ON_FIELD, bool)`, but always skips the current element.
+        /// Returns the bitmask of the missing required keys, if it is not an object, all `required` keys are missing.
         template<typename ON_FIELD>
-        void get_object(ON_FIELD on_field)
+        uint64_t get_object(object_shape& shape, uint64_t required, ON_FIELD on_field, bool strict = false)
         {
-            if (!try_object(std::move(on_field)))
+            auto missing = try_object(shape, required, std::move(on_field), strict);
+            if (!missing)
                 skip_value();
+            return missing ? *missing : required;
+        }
+
+        /// Same as `get_object`, but `on_field` receives the key id in the `shape`, see `try_object(object_shape&, ON_FIELD)`.
+        template<typename ON_FIELD>
+        void get_object(object_shape& shape, ON_FIELD on_field)
+        {
+            if (!try_object(shape, std::move(on_field)))
+                skip_value();
+        }
+
+        /// Skips the current element and returns its JSON text (without surrounding whitespaces).
+        /// The returned view points to the parsed data block.
+        /// It allows to postpone the element parsing or to pass it to another `memory_block_reader`.
+        /// If the element is malformed, the `memory_block_reader` switches to the error state and returns an empty view.
+        std::string_view get_raw_value();
+
+        /// Counters of records handled by `try_array_recovering` and `read_records`.
+        struct recovery_stats
+        {
+            size_t records = 0;
+            size_t failed = 0;
+        };
+
+        /// Attempts to extract an array from the current position, isolating errors in its items.
+        /// Works as `try_array`, but if the item parsing switches the reader to the error state
+        /// (by malformed data or by `set_error` call from `on_item`), the reader:
+        /// - calls `on_error(size_t item_index, const std::string& message, const char* error_pos)`,
+        /// - clears the error state and skips the whole item,
+        /// - continues with the next item.
+        /// Only if the item can't be skipped (unterminated strings, unbalanced brackets),
+        /// the error is reported to `on_error` and the reader stays in the error state.
+        /// Returns false and leaves the position intact if the current position doesn't contain an array.
+        /// Fills the optional `stats` with the item counters.
+        template<typename ON_ITEM, typename ON_ERROR>
+        bool try_array_recovering(ON_ITEM on_item, ON_ERROR on_error, recovery_stats* stats = nullptr)
+        {
+            recovery_stats local_stats;
+            if (!stats)
+                stats = &local_stats;
+            if (!is('['))
+                return false;
+            nesting_guard nesting(*this);
+            if (is(']') || error_pos)
+                return true;
+            do {
+                auto start = pos;
+                on_item();
+                if (error_pos) {
+                    stats->failed++;
+                    if (!recover(start, stats->records++, on_error))
+                        return true;
+                } else {
+                    stats->records++;
+                }
+            } while (is(','));
+            if (!is(']'))
+                set_error("expected ',' or ']'");
+            return true;
+        }
+
+        /// Extracts a sequence of records separated with new lines (NDJSON/JSON lines) starting from the current position.
+        /// Calls `on_record` for each non-empty line. It must extract one JSON element with any reader methods.
+        /// Each record is parsed in isolation: if it is malformed, has unexpected data after the element,
+        /// or `on_record` calls `set_error`, the reader:
+        /// - calls `on_error(size_t record_index, const std::string& message, const char* error_pos)`,
+        /// - clears the error state,
+        /// - continues from the next line.
+        /// So bad input costs one record, not the rest of the stream.
+        /// Returns the record counters.
+        template<typename ON_RECORD, typename ON_ERROR>
+        recovery_stats read_records(ON_RECORD on_record, ON_ERROR on_error)
+        {
+            recovery_stats stats;
+            auto data_end = end;
+            while (pos != data_end) {
+                auto line_end = (const unsigned char*)memchr(pos, '\n', data_end - pos);
+                end = line_end ? line_end : data_end;
+                skip_ws();
+                if (pos != end) {
+                    on_record();
+                    if (pos != end && !error_pos)
+                        set_error("unexpected data after record");
+                    if (error_pos) {
+                        on_error(stats.records, error_text, (const char*)error_pos);
+                        clear_error();
+                        stats.failed++;
+                    }
+                    stats.records++;
+                }
+                end = data_end;
+                pos = line_end ? line_end + 1 : data_end;
+            }
+            skip_ws();
+            return stats;
+        }
+
+        /// Moves to the element addressed by the JSON Pointer (RFC 6901) relative to the current element.
+        /// Object fields are found by comparing raw key bytes (keys with escapes are decoded),
+        /// array items are found by counting skipped items, and all other elements are skipped without decoding.
+        /// With an index set by `set_index` containers are skipped in one jump and array items are found by counting commas in the index.
+        /// If the element is found, returns true and leaves the reader positioned at it, ready for `get_*`/`try_*` calls.
+        /// Since the rest of the document stays unparsed, `success()` is not applicable after `seek`, check `get_error_message` instead.
+        /// If the element is not found, returns false and leaves the position intact.
+        /// If the data is malformed, returns false and switches to the error state.
+        /// Example:
+        /// memory_block_reader json(data);
+        /// double price = json.seek("/data/items/1234/price") ? json.get_number(0) : 0;
+        bool seek(std::string_view json_pointer);
+
+        /// Saved reader state, see `mark`.
+        struct checkpoint
+        {
+            const unsigned char* pos;
+            const unsigned char* error_pos;
+        };
+
+        /// Saves the current position and error state, allowing to `rewind` to it.
+        /// It allows to try alternative interpretations of the same data without intermediate DOM.
+        /// Marks cost nothing, since the whole data is in memory, and they stay valid until `reset`.
+        /// Example:
+        /// auto start = json.mark();
+        /// if (!try_read_circle(json, shape)) {
+        ///     json.rewind(start);
+        ///     read_polygon(json, shape);
+        /// }
+        checkpoint mark() { return { pos, error_pos }; }
+
+        /// Restores the position and error state saved by `mark`.
+        /// Must be called at the same nesting level (in the same `on_item`/`on_field` handler) where the mark was made.
+        /// Always returns true (unlike `istream_reader::rewind`, that can fail).
+        bool rewind(const checkpoint& mark)
+        {
+            pos = mark.pos;
+            if (!mark.error_pos)
+                clear_error();
+            return true;
         }
 
         /// Sets error state.
@@ -242,21 +444,86 @@ namespace reactive_json
         const std::string& get_error_message() { return error_text; }
 
     private:
-        const unsigned char* handle_object_start(std::string& field_name);
-        bool handle_object_cont(std::string& field_name, const unsigned char*& start_pos);
-        bool get_codepoint(size_t& val);
+        friend class reader_core<memory_block_reader>;
+        using reader_core::is;
+
+        // Input policy for `reader_core`.
+        unsigned char peek() const { return pos != end ? *pos : 0; }
+        void next() { pos++; }
+        const unsigned char* position() const { return pos; }
+        bool has_error() const { return error_pos != nullptr; }
+        void end_value() {}
+
+        // Reports the error of the item started at `start` and skips this item.
+        template<typename ON_ERROR>
+        bool recover(const unsigned char* start, size_t item_index, ON_ERROR& on_error)
+        {
+            on_error(item_index, error_text, (const char*)error_pos);
+            auto item_error_pos = error_pos;
+            auto item_error_text = std::move(error_text);
+            clear_error();
+            pos = start;
+            skip_value();
+            if (!error_pos)
+                return true;
+            error_pos = item_error_pos;
+            error_text = std::move(item_error_text);
+            pos = end;
+            return false;
+        }
+
+        void clear_error()
+        {
+            error_pos = nullptr;
+            error_text.clear();
+        }
+
+        template<typename ON_ITEM, typename IS_OVER>
+        bool try_array_slice_until(array_slice& slice, ON_ITEM& on_item, IS_OVER is_over)
+        {
+            if (slice.finished)
+                return true;
+            if (!slice.started) {
+                if (!is('['))
+                    return false;
+                slice.started = true;
+                if (is(']')) {
+                    slice.finished = true;
+                    return true;
+                }
+            }
+            nesting_guard nesting(*this);
+            if (error_pos) {
+                slice.finished = true;
+                return true;
+            }
+            do {
+                on_item();
+                slice.items++;
+                if (!is(',')) {
+                    if (!is(']'))
+                        set_error("expected ',' or ']'");
+                    slice.finished = true;
+                    return true;
+                }
+            } while (!is_over());
+            return true;
+        }
+
         size_t get_codepoint_no_check(const unsigned char*& pos);
         void put_utf8(size_t v, char*& dst);
         void skip_ws();
         void skip_string();
         void skip_value();
-        void skip_until(char term);
-        bool is(char term);
         bool is(const char* term);
-        bool handle_field_name(std::string& field_name);
+        bool read_field_key(std::string_view& key, std::string& buffer);
+        size_t handle_shape_field(object_shape& shape, size_t prev_key);
 
+        const unsigned char* begin;
         const unsigned char* pos;
         const unsigned char* end;
+        const structural_index* index = nullptr;
+        size_t allocated = 0;
         const unsigned char* error_pos;
         std::string error_text;
     };
@@ -1,7 +1,185 @@
+#include <vector>
 #include "memory_block_reader.h"
+#include "gunit.h"
 
 #define GROUP_NAME ReactiveJsonReader
 #define MK_READER(name, text) reactive_json::memory_block_reader name(text)
 #define RESET_READER(name, text) name.reset(text)
 
 #include "reader_tests.inc"
+
+namespace
+{
+    TEST(ReactiveJsonReader, ArraySlices) {
+        reactive_json::memory_block_reader json("[1, 2, 3, 4, 5, 6, 7] ");
+        reactive_json::memory_block_reader::array_slice slice;
+        std::vector<double> items;
+        int ticks = 0;
+        while (!slice.finished) {
+            ASSERT_TRUE(json.try_array_slice(slice, 5, [&] { items.push_back(json.get_number(0)); }));
+            ticks++;
+        }
+        ASSERT_EQ(ticks, 4);
+        ASSERT_EQ(items.size(), 7);
+        ASSERT_EQ(slice.items, 7);
+        ASSERT_TRUE(json.success());
+
+        json.reset("[[1], [2], [3]");
+        slice = {};
+        items.clear();
+        while (!slice.finished)
+            json.try_array_slice(slice, std::chrono::steady_clock::now(), [&] {
+                json.get_array([&] { items.push_back(json.get_number(0)); });
+            });
+        ASSERT_EQ(items.size(), 3);
+        ASSERT_FALSE(json.success());
+
+        json.reset("{}");
+        slice = {};
+        ASSERT_FALSE(json.try_array_slice(slice, 100, [] {}));
+        ASSERT_FALSE(slice.started);
+    }
+
+    TEST(ReactiveJsonReader, ArrayRecovery) {
+        reactive_json::memory_block_reader json(R"-([{"x": 1}, {"x": "bad"}, {"x": 3, "y": [1 2]}, {"x": 4}])-");
+        std::vector<double> xs;
+        std::vector<size_t> failed;
+        reactive_json::memory_block_reader::recovery_stats stats;
+        ASSERT_TRUE(json.try_array_recovering(
+            [&] {
+                json.get_object([&](auto name) {
+                    if (name == "x") {
+                        if (auto x = json.try_number())
+                            xs.push_back(*x);
+                        else
+                            json.set_error("x must be a number");
+                    } else if (name == "y") {
+                        json.get_array([&] { json.get_number(0); });
+                    }
+                });
+            },
+            [&](size_t index, const std::string& message, const char* pos) { failed.push_back(index); },
+            &stats));
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(xs.size(), 3);
+        ASSERT_EQ(xs[2], 4);
+        ASSERT_EQ(failed.size(), 2);
+        ASSERT_EQ(failed[0], 1);
+        ASSERT_EQ(failed[1], 2);
+        ASSERT_EQ(stats.records, 4);
+        ASSERT_EQ(stats.failed, 2);
+
+        json.reset(R"-([1, "unterminated, 2])-");
+        failed.clear();
+        json.try_array_recovering([&] { json.get_string(""); }, [&](size_t index, auto&, auto) { failed.push_back(index); });
+        ASSERT_FALSE(json.success());
+        ASSERT_EQ(json.get_error_message(), "incomplete string");
+        ASSERT_EQ(failed.size(), 1);
+        ASSERT_EQ(failed[0], 1);
+    }
+
+    TEST(ReactiveJsonReader, RecordsRecovery) {
+        reactive_json::memory_block_reader json(
+            "{\"id\": 1}\n"
+            "{\"id\": 2, \"broken\": [}\n"
+            "\n"
+            "{\"id\": \"3\"}\n"
+            "{\"id\": 4} 5\n"
+            "{\"id\": 6}");
+        std::vector<int> ids;
+        std::vector<std::string> errors;
+        auto stats = json.read_records(
+            [&] {
+                json.get_object([&](auto name) {
+                    if (name == "id") {
+                        if (auto id = json.try_number())
+                            ids.push_back((int)*id);
+                        else
+                            json.set_error("bad id");
+                    }
+                });
+            },
+            [&](size_t index, const std::string& message, const char* pos) {
+                errors.push_back(std::to_string(index) + ":" + message);
+            });
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(stats.records, 5);
+        ASSERT_EQ(stats.failed, 3);
+        ASSERT_EQ(ids.size(), 4);
+        ASSERT_EQ(ids.back(), 6);
+        ASSERT_EQ(errors.size(), 3);
+        ASSERT_EQ(errors[1], "2:bad id");
+        ASSERT_EQ(errors[2], "3:unexpected data after record");
+    }
+
+    TEST(ReactiveJsonReader, Seek) {
+        const char* data =
+            "{\"meta\": {\"skip\": [1, {\"a\": \"}\"}]},"
+            " \"a/b\": 1, \"m~n\": 2, \"e\\u0073c\": 3,"
+            " \"items\": [10, [20], {\"price\": 30.5}]}";
+        auto seek = [&](const char* pointer) {
+            reactive_json::memory_block_reader json(data);
+            return json.seek(pointer) ? json.get_number(-1) : -2;
+        };
+        ASSERT_EQ(seek("/items/2/price"), 30.5);
+        ASSERT_EQ(seek("/items/1/0"), 20);
+        ASSERT_EQ(seek("/a~1b"), 1);
+        ASSERT_EQ(seek("/m~0n"), 2);
+        ASSERT_EQ(seek("/esc"), 3);
+        ASSERT_EQ(seek("/items/3"), -2);
+        ASSERT_EQ(seek("/items/01"), -2);
+        ASSERT_EQ(seek("/items/-"), -2);
+        ASSERT_EQ(seek("/items/18446744073709551617"), -2);  // 2^64 + 1
+        ASSERT_EQ(seek("/missing"), -2);
+        ASSERT_EQ(seek("/items/0/x"), -2);
+
+        reactive_json::memory_block_reader json(data);
+        ASSERT_FALSE(json.seek("/meta/none"));
+        ASSERT_TRUE(json.get_error_message().empty());
+        ASSERT_TRUE(json.seek(""));
+        int fields = 0;
+        json.get_object([&](auto) { fields++; });
+        ASSERT_EQ(fields, 5);
+        ASSERT_TRUE(json.success());
+
+        json.reset("{\"a\": [1: 2]}");
+        ASSERT_FALSE(json.seek("/a/1"));
+        ASSERT_EQ(json.get_error_message(), "expected ',' or ']'");
+        json.reset("{}");
+        ASSERT_FALSE(json.seek("a"));
+        ASSERT_EQ(json.get_error_message(), "invalid json pointer");
+    }
+
+    TEST(ReactiveJsonReader, FieldKeyLimit) {
+        reactive_json::reader_limits limits;
+        limits.max_string_size = 3;
+        reactive_json::memory_block_reader json("{\"abc\": 1, \"long_key\": 2}");
+        json.set_limits(limits);
+        ASSERT_FALSE(json.seek("/x"));
+        ASSERT_EQ(json.get_error_message(), "string too long");
+        json.reset("{\"abc\": 1, \"long_key\": 2}");
+        reactive_json::object_shape shape{ "abc" };
+        json.get_object(shape, [&](size_t) { json.get_number(0); });
+        ASSERT_EQ(json.get_error_message(), "string too long");
+    }
+
+    TEST(ReactiveJsonReader, ArraySized) {
+        reactive_json::memory_block_reader json("[[], [1, \"a,]\", {\"x\": [2, 3]}], 4, [5, 6]]");
+        ASSERT_EQ(json.count_array_items(), 4);
+        std::vector<size_t> sizes;
+        json.get_array([&] {
+            std::vector<double> items;
+            json.get_array_sized(
+                [&](size_t size) { sizes.push_back(size); items.reserve(size); },
+                [&] { json.get_bool(false); });
+        });
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(sizes.size(), 3);
+        ASSERT_EQ(sizes[0], 0);
+        ASSERT_EQ(sizes[1], 3);
+        ASSERT_EQ(sizes[2], 2);
+        json.reset("\"[1,2]\"");
+        ASSERT_EQ(json.count_array_items(), 0);
+        ASSERT_EQ(json.get_string(""), "[1,2]");
+    }
+}
@@ -0,0 +1,37 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "object_shape.h"
+
+namespace reactive_json
+{
+    object_shape::object_shape(std::initializer_list<std::string_view> keys)
+        : keys(keys.begin(), keys.end())
+        , predicted(keys.size() + 1, unknown)
+    {}
+
+    size_t object_shape::find(std::string_view key, size_t prev_key)
+    {
+        auto& next = predicted[prev_key + 1];
+        if (next != unknown && keys[next] == key) {
+            hits++;
+            return next;
+        }
+        misses++;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key)
+                return next = i;
+        }
+        return unknown;
+    }
+}
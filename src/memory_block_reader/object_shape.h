@@ -0,0 +1,69 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_OBJECT_SHAPE_H
+#define REACTIVE_JSON_OBJECT_SHAPE_H
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace reactive_json
+{
+    /// The set of field names expected by one `get_object` call site, mapped to key ids (indexes in the constructor list).
+    /// It learns the order of fields in the parsed objects:
+    /// for each key it remembers the key that followed it last time and checks this key first,
+    /// so records having the same field order need one key comparison per field.
+    /// On a miss it falls back to comparing with all keys.
+    /// Shape is mutable and must not be shared between threads.
+    /// Example:
+    /// static thread_local object_shape shape{ "x", "y" };
+    /// json.get_object(shape, [&](size_t key) {
+    ///     switch (key) {
+    ///     case 0: pt.x = json.get_number(0); break;
+    ///     case 1: pt.y = json.get_number(0); break;
+    ///     }
+    /// });
+    class object_shape
+    {
+    public:
+        static constexpr size_t unknown = ~size_t(0);
+
+        object_shape(std::initializer_list<std::string_view> keys);
+
+        /// Returns the id of the `key` or `unknown`.
+        /// `prev_key` is the id of the preceding known key of the same object, or `unknown` for the first field.
+        size_t find(std::string_view key, size_t prev_key);
+
+        /// Returns the number of keys.
+        size_t size() const { return keys.size(); }
+
+        /// Returns the key name by its id.
+        const std::string& get_key(size_t key) const { return keys[key]; }
+
+        /// Returns the number of keys found by the prediction.
+        size_t get_hits() const { return hits; }
+
+        /// Returns the number of keys that required the full lookup (including the unknown keys).
+        size_t get_misses() const { return misses; }
+
+    private:
+        std::vector<std::string> keys;
+        std::vector<size_t> predicted;  // by `prev_key + 1`, so the object start (`unknown`) gets slot 0
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+}
+
+#endif  // REACTIVE_JSON_OBJECT_SHAPE_H
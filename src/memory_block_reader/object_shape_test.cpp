@@ -0,0 +1,89 @@
+#include <cstring>
+#include <string>
+#include <vector>
+#include "memory_block_reader.h"
+#include "gunit.h"
+
+namespace
+{
+    struct point { double x = 0, y = 0; };
+
+    std::vector<point> read_points(const char* data, reactive_json::object_shape& shape, bool* success = nullptr)
+    {
+        reactive_json::memory_block_reader json(data);
+        std::vector<point> result;
+        json.get_array([&] {
+            result.emplace_back();
+            json.get_object(shape, [&, &pt = result.back()](size_t key) {
+                if (key == 0) pt.x = json.get_number(0);
+                else if (key == 1) pt.y = json.get_number(0);
+            });
+        });
+        if (success)
+            *success = json.success();
+        return result;
+    }
+
+    TEST(ObjectShape, LearnsFieldOrder)
+    {
+        reactive_json::object_shape shape{ "x", "y" };
+        bool success = false;
+        auto points = read_points(R"-([
+            {"x": 1, "y": 2},
+            {"x": 3, "y": 4},
+            {"x": 5, "extra": [{"x": 0}], "y": 6},
+            {"y": 8, "x": 7},
+            {}
+        ])-", shape, &success);
+        ASSERT_TRUE(success);
+        ASSERT_EQ(points.size(), 5);
+        ASSERT_EQ(points[2].y, 6);
+        ASSERT_EQ(points[3].x, 7);
+        ASSERT_EQ(points[3].y, 8);
+        ASSERT_EQ(shape.get_hits(), 4);  // x, y, x, y after extra
+        ASSERT_EQ(shape.get_misses(), 5);  // x, y, extra, y, x
+    }
+
+    TEST(ObjectShape, EscapedKeysAndErrors)
+    {
+        reactive_json::object_shape shape{ "x", "y" };
+        auto points = read_points(R"-([{"\u0078": 1, "y": 2}])-", shape);
+        ASSERT_EQ(points[0].x, 1);
+        ASSERT_EQ(points[0].y, 2);
+        bool success = true;
+        read_points(R"-([{"x" 1}])-", shape, &success);
+        ASSERT_FALSE(success);
+        read_points(R"-([{"x": 1 "y": 2}])-", shape, &success);
+        ASSERT_FALSE(success);
+    }
+
+    TEST(ObjectShape, RequiredAndStrict)
+    {
+        reactive_json::object_shape shape{ "id", "name", "tags" };
+        reactive_json::memory_block_reader json(R"-([
+            {"name": "a", "id": 1},
+            {"tags": [], "id": 2},
+            5
+        ])-");
+        std::vector<uint64_t> missing;
+        json.get_array([&] {
+            missing.push_back(json.get_object(shape, 0b011, [&](size_t key) {}));
+        });
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(missing.size(), 3);
+        ASSERT_EQ(missing[0], 0);
+        ASSERT_EQ(missing[1], 0b010);
+        ASSERT_EQ(missing[2], 0b011);
+
+        bool is_tags_parsed = false;
+        const char* data = R"-({"id": 1, "name": "a", "extra": [1, 2], "tags": []})-";
+        json.reset(data);
+        auto r = json.try_object(shape, 0b011, [&](size_t key) {
+            is_tags_parsed |= key == 2;
+        }, true);
+        ASSERT_TRUE(r.has_value());
+        ASSERT_EQ(json.get_error_message(), "unknown field");
+        ASSERT_EQ(json.get_error_pos(), strstr(data, "[1, 2]"));
+        ASSERT_FALSE(is_tags_parsed);
+    }
+}
@@ -0,0 +1,44 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <exception>
+
+#include "parallel_subtrees.h"
+
+namespace reactive_json
+{
+    parallel_subtrees::~parallel_subtrees()
+    {
+        for (auto& t : tasks)
+            t.wait();
+    }
+
+    std::vector<subtree_error> parallel_subtrees::join()
+    {
+        std::vector<subtree_error> errors;
+        std::exception_ptr exception;
+        for (auto& t : tasks) {
+            try {
+                if (auto error = t.get())
+                    errors.push_back(std::move(*error));
+            } catch (...) {
+                if (!exception)
+                    exception = std::current_exception();
+            }
+        }
+        tasks.clear();
+        if (exception)
+            std::rethrow_exception(exception);
+        return errors;
+    }
+}
@@ -0,0 +1,98 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_PARALLEL_SUBTREES_H
+#define REACTIVE_JSON_PARALLEL_SUBTREES_H
+
+#include <algorithm>
+#include <future>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "memory_block_reader.h"
+#include "../thread_pool/thread_pool.h"
+
+namespace reactive_json
+{
+    /// Error reported by a subtree parsed with `parallel_subtrees`.
+    struct subtree_error
+    {
+        /// Error position in the original data block.
+        const char* pos;
+        std::string message;
+    };
+
+    /// Parses independent parts of one document in parallel.
+    /// The main reader quickly skips a chosen field or array item,
+    /// and the skipped value is parsed by a new `memory_block_reader` on a pool thread.
+    /// Example:
+    /// thread_pool pool;
+    /// parallel_subtrees tasks(pool);
+    /// memory_block_reader json(data);
+    /// json.get_object([&](auto name) {
+    ///     if (name == "users")
+    ///         tasks.fork(json, [&](memory_block_reader& json) { users = read_users(json); });
+    ///     else if (name == "orders")
+    ///         tasks.fork(json, [&](memory_block_reader& json) { orders = read_orders(json); });
+    /// });
+    /// auto errors = tasks.join();
+    /// The data block must outlive the `join` call.
+    class parallel_subtrees
+    {
+    public:
+        explicit parallel_subtrees(thread_pool& pool)
+            : pool(pool)
+        {}
+
+        /// Waits for all not yet joined tasks.
+        ~parallel_subtrees();
+
+        /// Skips the current element of `json` and schedules its parsing on the pool.
+        /// `on_value` is a `void(memory_block_reader&)` lambda that receives a new reader positioned at the skipped element.
+        /// It runs concurrently with the main reader and other tasks, so it must only access its own data.
+        /// If the current element is malformed, the main `json` reader switches to the error state and no task is scheduled.
+        /// The new reader gets the limits of `json`, its `max_depth` is reduced by the depth of the skipped element,
+        /// and `max_allocated` applies to each task separately.
+        template<typename ON_VALUE>
+        void fork(memory_block_reader& json, ON_VALUE on_value)
+        {
+            auto limits = json.get_limits();
+            if (limits.max_depth != reader_limits::unlimited)
+                limits.max_depth -= std::min(limits.max_depth, json.get_depth());
+            auto text = json.get_raw_value();
+            if (text.empty()) {
+                json.set_error("expected value");
+                return;
+            }
+            tasks.push_back(pool.submit([text, limits, on_value = std::move(on_value)]() mutable -> std::optional<subtree_error> {
+                memory_block_reader json(text.data(), text.size());
+                json.set_limits(limits);
+                on_value(json);
+                if (json.success())
+                    return std::nullopt;
+                return subtree_error{ json.get_error_pos(), json.get_error_message() };
+            }));
+        }
+
+        /// Waits for all forked tasks and returns their errors in the forking order.
+        /// If some task has thrown an exception, rethrows it after all tasks finish.
+        std::vector<subtree_error> join();
+
+    private:
+        thread_pool& pool;
+        std::vector<std::future<std::optional<subtree_error>>> tasks;
+    };
+}
+
+#endif  // REACTIVE_JSON_PARALLEL_SUBTREES_H
@@ -0,0 +1,83 @@
+#include <vector>
+#include <string>
+#include "parallel_subtrees.h"
+#include "gunit.h"
+
+namespace
+{
+    TEST(ParallelSubtrees, IndependentSections)
+    {
+        const char* data = R"-({
+            "users": [{"name": "a"}, {"name": "b"}],
+            "skipped": {"x": [1, 2]},
+            "orders": [1, 2, 3, 4],
+            "broken": [1, "x", 3],
+            "products": "none"
+        })-";
+        reactive_json::thread_pool pool(3);
+        reactive_json::parallel_subtrees tasks(pool);
+        std::vector<std::string> users;
+        double orders_sum = 0;
+        std::string products;
+        reactive_json::memory_block_reader json(data);
+        json.get_object([&](auto name) {
+            if (name == "users") {
+                tasks.fork(json, [&](reactive_json::memory_block_reader& json) {
+                    json.get_array([&] {
+                        json.get_object([&](auto name) {
+                            if (name == "name")
+                                users.push_back(json.get_string(""));
+                        });
+                    });
+                });
+            } else if (name == "orders" || name == "broken") {
+                tasks.fork(json, [&, is_broken = name == "broken"](reactive_json::memory_block_reader& json) {
+                    double sum = 0;
+                    json.get_array([&] {
+                        if (auto n = json.try_number())
+                            sum += *n;
+                        else
+                            json.set_error("expected number");
+                    });
+                    if (!is_broken)
+                        orders_sum = sum;
+                });
+            } else if (name == "products") {
+                tasks.fork(json, [&](reactive_json::memory_block_reader& json) {
+                    products = json.get_string("");
+                });
+            }
+        });
+        ASSERT_TRUE(json.success());
+        auto errors = tasks.join();
+        ASSERT_EQ(users.size(), 2);
+        ASSERT_EQ(users[1], "b");
+        ASSERT_EQ(orders_sum, 10);
+        ASSERT_EQ(products, "none");
+        ASSERT_EQ(errors.size(), 1);
+        ASSERT_EQ(errors[0].message, "expected number");
+        ASSERT_EQ(*errors[0].pos, '"');
+    }
+
+    TEST(ParallelSubtrees, InheritedLimits)
+    {
+        const char* data = R"-({"a": [[1]], "b": "long text", "c": [[1]]})-";
+        reactive_json::reader_limits limits;
+        limits.max_depth = 3;
+        limits.max_string_size = 4;
+        reactive_json::thread_pool pool(2);
+        reactive_json::parallel_subtrees tasks(pool);
+        reactive_json::memory_block_reader json(data);
+        json.set_limits(limits);
+        json.get_object([&](auto name) {
+            tasks.fork(json, [&](reactive_json::memory_block_reader& json) {
+                if (!json.try_string())
+                    json.get_array([&] { json.get_array([&] { json.get_number(0); }); });
+            });
+        });
+        ASSERT_TRUE(json.success());
+        auto errors = tasks.join();
+        ASSERT_EQ(errors.size(), 1);
+        ASSERT_EQ(errors[0].message, "string too long");
+    }
+}
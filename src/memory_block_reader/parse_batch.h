@@ -0,0 +1,110 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_PARSE_BATCH_H
+#define REACTIVE_JSON_PARSE_BATCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "memory_block_reader.h"
+#include "../thread_pool/thread_pool.h"
+
+namespace reactive_json
+{
+    /// Outcome of one document parsed by `parse_batch`.
+    struct batch_result
+    {
+        bool success = false;
+
+        /// Error offset in the document, or the offset of the data left unread, meaningful only if not `success`.
+        size_t error_pos = 0;
+
+        std::string error_message;
+    };
+
+    /// Parses a batch of independent documents on the `pool` threads.
+    /// `on_document` is a `void(memory_block_reader& json, size_t index)` lambda,
+    /// that is called for each document with a reader positioned at its start.
+    /// It is called concurrently from different threads, so it must be thread-safe.
+    /// Each pool thread reuses one reader for all its documents, and threads take documents
+    /// from a shared counter in small groups, so threads that got smaller documents take more of them.
+    /// Returns the per-document results in the order of `documents`.
+    /// Exceptions thrown by `on_document` are rethrown after all threads stop.
+    /// Must not be called from a task running on the same `pool`.
+    /// Example:
+    /// std::vector<message> messages(buffers.size());
+    /// auto results = parse_batch(buffers, [&](memory_block_reader& json, size_t i) {
+    ///     messages[i] = read_message(json);
+    /// }, pool);
+    template<typename ON_DOCUMENT>
+    std::vector<batch_result> parse_batch(const std::vector<std::string_view>& documents, ON_DOCUMENT&& on_document, thread_pool& pool)
+    {
+        std::vector<batch_result> results(documents.size());
+        std::atomic<size_t> next{ 0 };
+        std::atomic<bool> failed{ false };
+        const size_t group = std::clamp<size_t>(documents.size() / (pool.size() * 8), 1, 64);
+        auto work = [&] {
+            memory_block_reader json("", 0);
+            for (;;) {
+                size_t from = next.fetch_add(group, std::memory_order_relaxed);
+                if (from >= documents.size() || failed.load(std::memory_order_relaxed))
+                    return;
+                for (size_t i = from, to = std::min(documents.size(), from + group); i != to; i++) {
+                    auto& r = results[i];
+                    if (documents[i].empty()) {
+                        r.error_message = "empty document";
+                        continue;
+                    }
+                    json.reset(documents[i].data(), documents[i].size());
+                    try {
+                        on_document(json, i);
+                    } catch (...) {
+                        failed = true;
+                        throw;
+                    }
+                    r.success = json.success();
+                    if (!r.success) {
+                        r.error_message = json.get_error_message();
+                        // Without an error the document is not read to the end, and the reader stays where `on_document` left it.
+                        auto error_pos = json.get_error_pos();
+                        r.error_pos = (error_pos ? error_pos : (const char*)json.mark().pos) - documents[i].data();
+                        if (r.error_message.empty())
+                            r.error_message = "unexpected data after document";
+                    }
+                }
+            }
+        };
+        std::vector<std::future<void>> tasks;
+        for (size_t i = 0; i < std::min(pool.size(), documents.size()); i++)
+            tasks.push_back(pool.submit(work));
+        std::exception_ptr exception;
+        for (auto& t : tasks) {
+            try {
+                t.get();
+            } catch (...) {
+                if (!exception)
+                    exception = std::current_exception();
+            }
+        }
+        if (exception)
+            std::rethrow_exception(exception);
+        return results;
+    }
+}
+
+#endif  // REACTIVE_JSON_PARSE_BATCH_H
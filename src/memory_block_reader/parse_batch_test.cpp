@@ -0,0 +1,49 @@
+#include <string>
+#include <vector>
+#include "parse_batch.h"
+#include "gunit.h"
+
+namespace
+{
+    TEST(ParseBatch, PerDocumentResults)
+    {
+        std::vector<std::string> texts;
+        for (int i = 0; i < 1000; i++)
+            texts.push_back(i % 100 == 7
+                ? "{\"id\": " + std::to_string(i) + ", \"v\": [1, 2}"
+                : "{\"id\": " + std::to_string(i) + ", \"v\": [1, 2]}");
+        texts.push_back("");
+        std::vector<std::string_view> documents(texts.begin(), texts.end());
+        std::vector<int> ids(documents.size(), -1);
+        reactive_json::thread_pool pool(4);
+        auto results = reactive_json::parse_batch(documents, [&](reactive_json::memory_block_reader& json, size_t i) {
+            json.get_object([&](auto name) {
+                if (name == "id")
+                    ids[i] = (int)json.get_number(-1);
+            });
+        }, pool);
+        ASSERT_EQ(results.size(), documents.size());
+        for (size_t i = 0; i < 1000; i++) {
+            ASSERT_EQ(ids[i], int(i));
+            ASSERT_EQ(results[i].success, i % 100 != 7);
+            if (!results[i].success) {
+                ASSERT_EQ(results[i].error_message, "mismatched }");
+                ASSERT_EQ(results[i].error_pos, documents[i].size());
+            }
+        }
+        ASSERT_FALSE(results.back().success);
+    }
+
+    TEST(ParseBatch, UnreadDataPosition)
+    {
+        std::vector<std::string_view> documents{ "[1, 2] [3]", "[1]" };
+        reactive_json::thread_pool pool(2);
+        auto results = reactive_json::parse_batch(documents, [&](reactive_json::memory_block_reader& json, size_t) {
+            json.get_array([&] { json.get_number(0); });
+        }, pool);
+        ASSERT_FALSE(results[0].success);
+        ASSERT_EQ(results[0].error_message, "unexpected data after document");
+        ASSERT_EQ(results[0].error_pos, 7);
+        ASSERT_TRUE(results[1].success);
+    }
+}
@@ -0,0 +1,46 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "shared_document.h"
+
+namespace reactive_json
+{
+    shared_document::shared_document(std::string data, thread_pool* pool)
+        : own_data(std::move(data))
+        , data(own_data.data())
+        , size(own_data.size())
+    {
+        build(pool);
+    }
+
+    shared_document::shared_document(const char* data, size_t length, thread_pool* pool)
+        : data(data)
+        , size(length)
+    {
+        build(pool);
+    }
+
+    void shared_document::build(thread_pool* pool)
+    {
+        is_valid = index.build(data, size, pool);
+    }
+
+    memory_block_reader shared_document::cursor() const
+    {
+        // Zero length makes memory_block_reader measure the data with strlen.
+        memory_block_reader r(size ? data : "", size);
+        if (is_valid)
+            r.set_index(&index);
+        return r;
+    }
+}
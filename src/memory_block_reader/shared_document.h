@@ -0,0 +1,68 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_SHARED_DOCUMENT_H
+#define REACTIVE_JSON_SHARED_DOCUMENT_H
+
+#include <string>
+
+#include "memory_block_reader.h"
+#include "structural_index.h"
+
+namespace reactive_json
+{
+    /// An immutable JSON data block with its structural index, built once and queried by any number of threads.
+    /// Each thread makes its own `cursor`: a `memory_block_reader` over the shared data and index,
+    /// that has the normal `get_*`/`try_*`/`seek` API, skips unneeded containers in one jump using the index,
+    /// and finds array items addressed by `seek` without scanning the items before them.
+    /// Cursors don't lock anything and don't allocate (except for the extracted strings), so they are cheap to make per query.
+    /// Example:
+    /// shared_document doc(std::move(catalog_text), &pool);
+    /// ... on any thread:
+    /// auto json = doc.cursor();
+    /// double price = json.seek("/items/1234/price") ? json.get_number(0) : 0;
+    class shared_document
+    {
+    public:
+        /// Takes ownership of the data and builds the index, on `pool` threads if given.
+        explicit shared_document(std::string data, thread_pool* pool = nullptr);
+
+        /// Uses the `length` bytes of `data`, that must stay unchanged while this document and its cursors exist.
+        shared_document(const char* data, size_t length, thread_pool* pool = nullptr);
+
+        shared_document(const shared_document&) = delete;
+        shared_document& operator= (const shared_document&) = delete;
+
+        /// Returns a new reader at the document root.
+        /// If the document is malformed, cursors have no index and report errors as they reach them.
+        memory_block_reader cursor() const;
+
+        /// Returns true if the index is built, otherwise the index `get_error_message` tells why.
+        bool is_indexed() const { return is_valid; }
+
+        const structural_index& get_index() const { return index; }
+        const char* get_data() const { return data; }
+        size_t get_size() const { return size; }
+
+    private:
+        void build(thread_pool* pool);
+
+        std::string own_data;
+        const char* data;
+        size_t size;
+        structural_index index;
+        bool is_valid = false;
+    };
+}
+
+#endif  // REACTIVE_JSON_SHARED_DOCUMENT_H
@@ -0,0 +1,80 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include "shared_document.h"
+#include "gunit.h"
+
+namespace
+{
+    std::string make_items(size_t count)
+    {
+        std::string r = R"-({"meta": {"count": )-" + std::to_string(count) + R"-(}, "items": [)-";
+        for (size_t i = 0; i < count; i++) {
+            r += i ? ", " : "";
+            r += R"-({"id": )-" + std::to_string(i)
+                + R"-(, "tags": [[], {"a,]": "[x"}], "price": )-" + std::to_string(i * 2) + "}";
+        }
+        return r + "]}";
+    }
+
+    TEST(SharedDocument, IndexedSeekMatchesScan)
+    {
+        const char* data = R"-({"a": [[1, [2, 3]], {"b": [4, 5]}, "x,]", 6], "c": []})-";
+        reactive_json::shared_document doc(data, strlen(data));
+        ASSERT_TRUE(doc.is_indexed());
+        for (auto pointer : { "/a/0/1/1", "/a/1/b/1", "/a/2", "/a/3", "/a/4", "/a/0/2", "/c/0", "/a/00", "" }) {
+            auto indexed = doc.cursor();
+            reactive_json::memory_block_reader scanned(data);
+            bool found = scanned.seek(pointer);
+            ASSERT_EQ(indexed.seek(pointer), found);
+            ASSERT_EQ(indexed.get_raw_value(), scanned.get_raw_value());
+        }
+    }
+
+    TEST(SharedDocument, ConcurrentCursors)
+    {
+        const size_t count = 2000;
+        reactive_json::thread_pool pool(2);
+        reactive_json::shared_document doc(make_items(count), &pool);
+        ASSERT_TRUE(doc.is_indexed());
+        std::vector<size_t> failures(4);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < failures.size(); t++) {
+            threads.emplace_back([&, t] {
+                for (size_t i = t; i < count; i += 7) {
+                    auto json = doc.cursor();
+                    if (!json.seek("/items/" + std::to_string(i) + "/price") || json.get_number(0) != double(i * 2))
+                        failures[t]++;
+                }
+                auto json = doc.cursor();
+                size_t sum = 0;
+                json.get_object([&](auto name) {
+                    if (name == "items") {
+                        json.get_array([&] {
+                            json.get_object([&](auto name) {
+                                if (name == "id")
+                                    sum += size_t(json.get_number(0));
+                            });
+                        });
+                    }
+                });
+                if (!json.success() || sum != count * (count - 1) / 2)
+                    failures[t]++;
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        for (auto f : failures)
+            ASSERT_EQ(f, 0);
+    }
+
+    TEST(SharedDocument, Malformed)
+    {
+        reactive_json::shared_document doc(std::string(R"-({"a": [1, 2})-"));
+        ASSERT_FALSE(doc.is_indexed());
+        ASSERT_EQ(doc.get_index().get_error_message(), "mismatched }");
+        auto json = doc.cursor();
+        json.get_object([&](auto) { json.get_array([] {}); });
+        ASSERT_FALSE(json.success());
+    }
+}
@@ -0,0 +1,437 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+
+#include "../file_replace/file_replace.h"
+#include "structural_index.h"
+
+namespace reactive_json
+{
+    namespace
+    {
+        constexpr size_t npos = structural_index::npos;
+
+        struct chunk
+        {
+            size_t begin, end;
+
+            // Structural characters found by the scan pass as `offset << 1 | in_string`,
+            // where `in_string` assumes that the chunk starts outside a string.
+            std::vector<size_t> candidates;
+            bool odd_quotes = false;
+
+            // Structural characters outside strings and their matches, indexes are local to the chunk.
+            std::vector<size_t> positions;
+            std::vector<size_t> pairs;
+            std::vector<size_t> unmatched_closes;  // in order, they all precede `unmatched_opens`
+            std::vector<size_t> unmatched_opens;
+            size_t base = 0;  // index of the first chunk position in the global index
+
+            size_t error_pos = npos;
+            const char* error_text = nullptr;
+        };
+
+        bool is_open(unsigned char c) { return c == '[' || c == '{'; }
+        unsigned char closing(unsigned char c) { return c == '[' ? ']' : '}'; }
+
+        void scan(const unsigned char* data, chunk& c)
+        {
+            size_t escapes = 0;
+            while (escapes < c.begin && data[c.begin - escapes - 1] == '\\')
+                escapes++;
+            bool escaped = escapes % 2 != 0;
+            bool in_string = false;
+            for (size_t i = c.begin; i != c.end; i++) {
+                if (escaped) {
+                    escaped = false;
+                    continue;
+                }
+                switch (data[i]) {
+                case '\\':
+                    escaped = true;
+                    break;
+                case '"':
+                    in_string = !in_string;
+                    break;
+                case '{': case '}': case '[': case ']': case ',':
+                    c.candidates.push_back(i << 1 | size_t(in_string));
+                    break;
+                default:
+                    break;
+                }
+            }
+            c.odd_quotes = in_string;
+        }
+
+        void match(const unsigned char* data, chunk& c, bool starts_in_string)
+        {
+            std::vector<size_t>& opens = c.unmatched_opens;
+            for (auto candidate : c.candidates) {
+                if (bool(candidate & 1) != starts_in_string)
+                    continue;
+                size_t offset = candidate >> 1;
+                size_t index = c.positions.size();
+                c.positions.push_back(offset);
+                c.pairs.push_back(npos);
+                auto ch = data[offset];
+                if (is_open(ch))
+                    opens.push_back(index);
+                else if (ch != ',') {
+                    if (opens.empty()) {
+                        c.unmatched_closes.push_back(index);
+                        continue;
+                    }
+                    if (closing(data[c.positions[opens.back()]]) != ch) {
+                        c.error_pos = offset;
+                        c.error_text = ch == '}' ? "mismatched }" : "mismatched ]";
+                        break;
+                    }
+                    c.pairs[index] = opens.back();
+                    c.pairs[opens.back()] = index;
+                    opens.pop_back();
+                }
+            }
+            c.candidates = std::vector<size_t>();
+        }
+
+        // Snapshot file layout: `snapshot_header`, `count` positions and `count` pairs,
+        // each stored as `item_size`-byte integers in the native byte order (pairs use `~0` for `npos`).
+        struct snapshot_header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t item_size;
+            uint64_t byte_order;
+            uint64_t data_length;
+            uint64_t data_hash;
+            uint64_t source_size;  // the source file stamp, see `source_stamp`
+            int64_t source_time;
+            uint64_t count;
+        };
+
+        const char snapshot_magic[8] = { 'R', 'J', 'S', 'I', 'N', 'D', 'E', 'X' };
+        const uint32_t snapshot_version = 2;
+        const uint64_t byte_order_mark = 0x0102030405060708;
+
+        // Size and modification time of the file the indexed data was read from, zeros if it is unknown.
+        struct source_stamp
+        {
+            uint64_t size = 0;
+            int64_t time = 0;
+        };
+
+        source_stamp get_source_stamp(const std::string& source_file_name)
+        {
+            source_stamp r;
+            if (source_file_name.empty())
+                return r;
+            std::error_code error;
+            auto size = std::filesystem::file_size(source_file_name, error);
+            if (error)
+                return r;
+            auto time = std::filesystem::last_write_time(source_file_name, error);
+            if (error)
+                return r;
+            r.size = size;
+            r.time = int64_t(time.time_since_epoch().count());
+            return r;
+        }
+
+        template<typename T>
+        bool write_items(std::ostream& out, const std::vector<size_t>& items)
+        {
+            std::vector<T> buffer;
+            for (size_t i = 0; i < items.size(); i += 1 << 16) {
+                size_t n = std::min(items.size() - i, size_t(1) << 16);
+                buffer.resize(n);
+                for (size_t j = 0; j < n; j++)
+                    buffer[j] = T(items[i + j]);
+                out.write((const char*)buffer.data(), n * sizeof(T));
+            }
+            return bool(out);
+        }
+
+        template<typename T>
+        bool read_items(std::istream& in, std::vector<size_t>& items, size_t count)
+        {
+            items.resize(count);
+            if (sizeof(T) == sizeof(size_t))
+                return bool(in.read((char*)items.data(), count * sizeof(T)));
+            std::vector<T> buffer;
+            for (size_t i = 0; i < count; i += 1 << 16) {
+                size_t n = std::min(count - i, size_t(1) << 16);
+                buffer.resize(n);
+                if (!in.read((char*)buffer.data(), n * sizeof(T)))
+                    return false;
+                for (size_t j = 0; j < n; j++)
+                    items[i + j] = buffer[j] == T(~T(0)) ? npos : size_t(buffer[j]);
+            }
+            return true;
+        }
+
+        template<typename FN>
+        void for_each_chunk(std::vector<chunk>& chunks, thread_pool* pool, FN fn)
+        {
+            if (!pool || chunks.size() == 1) {
+                for (auto& c : chunks)
+                    fn(c);
+                return;
+            }
+            std::vector<std::future<void>> tasks;
+            for (auto& c : chunks)
+                tasks.push_back(pool->submit([&fn, &c] { fn(c); }));
+            for (auto& t : tasks)
+                t.get();
+        }
+    }
+
+    bool structural_index::build(const char* text, size_t length, thread_pool* pool, size_t chunk_size)
+    {
+        auto data = (const unsigned char*)text;
+        positions.clear();
+        pairs.clear();
+        max_depth = 0;
+        error_pos = npos;
+        error_text.clear();
+
+        std::vector<chunk> chunks;
+        if (!pool || !chunk_size)
+            chunk_size = length;
+        else
+            chunk_size = std::max(chunk_size, length / (pool->size() * 4) + 1);
+        for (size_t begin = 0; begin < length || chunks.empty(); begin += chunk_size) {
+            chunks.emplace_back();
+            chunks.back().begin = begin;
+            chunks.back().end = std::min(length, begin + chunk_size);
+        }
+
+        for_each_chunk(chunks, pool, [&](chunk& c) { scan(data, c); });
+        bool in_string = false;
+        std::vector<bool> starts_in_string;
+        for (auto& c : chunks) {
+            starts_in_string.push_back(in_string);
+            in_string ^= c.odd_quotes;
+        }
+        for_each_chunk(chunks, pool, [&](chunk& c) { match(data, c, starts_in_string[&c - chunks.data()]); });
+
+        auto set_error = [&](size_t pos, const char* text) {
+            if (pos < error_pos) {
+                error_pos = pos;
+                error_text = text;
+            }
+        };
+        size_t total = 0;
+        for (auto& c : chunks) {
+            if (c.error_text)
+                set_error(c.error_pos, c.error_text);
+            c.base = total;
+            total += c.positions.size();
+        }
+        positions.resize(total);
+        pairs.resize(total);
+        for_each_chunk(chunks, pool, [&](chunk& c) {
+            std::copy(c.positions.begin(), c.positions.end(), positions.begin() + c.base);
+            for (size_t i = 0; i < c.pairs.size(); i++)
+                pairs[c.base + i] = c.pairs[i] == npos ? npos : c.pairs[i] + c.base;
+        });
+
+        std::vector<size_t> opens;
+        for (auto& c : chunks) {
+            for (auto close : c.unmatched_closes) {
+                size_t index = close + c.base;
+                auto ch = data[positions[index]];
+                if (opens.empty() || closing(data[positions[opens.back()]]) != ch) {
+                    set_error(positions[index], ch == '}' ? "mismatched }" : "mismatched ]");
+                    break;
+                }
+                pairs[index] = opens.back();
+                pairs[opens.back()] = index;
+                opens.pop_back();
+            }
+            for (auto open : c.unmatched_opens)
+                opens.push_back(open + c.base);
+        }
+        max_depth = 0;
+        for (size_t i = 0, depth = 0; i < total; i++) {
+            if (pairs[i] == npos)
+                continue;
+            if (pairs[i] > i)
+                max_depth = std::max(max_depth, ++depth);
+            else
+                depth--;
+        }
+        if (in_string)
+            set_error(length, "incomplete string");
+        else if (!opens.empty())
+            set_error(length, data[positions[opens.back()]] == '{' ? "incomplete object" : "incomplete array");
+        return error_pos == npos;
+    }
+
+    size_t structural_index::find(size_t offset) const
+    {
+        auto it = std::lower_bound(positions.begin(), positions.end(), offset);
+        return it != positions.end() && *it == offset
+            ? size_t(it - positions.begin())
+            : npos;
+    }
+
+    bool structural_index::save(const std::string& file_name, const char* data, size_t length, const std::string& source_file_name) const
+    {
+        if (error_pos != npos)
+            return false;
+        snapshot_header header{};
+        std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+        header.version = snapshot_version;
+        header.item_size = length < 0xffffffff && positions.size() < 0xffffffff ? 4 : 8;
+        header.byte_order = byte_order_mark;
+        header.data_length = length;
+        header.data_hash = content_hash(data, length);
+        auto stamp = get_source_stamp(source_file_name);
+        header.source_size = stamp.size;
+        header.source_time = stamp.time;
+        header.count = positions.size();
+
+        // The snapshot is written aside and renamed, so concurrent readers never see it incomplete.
+        std::string temp_name = temp_file_name(file_name);
+        {
+            std::ofstream out(temp_name, std::ios::binary | std::ios::trunc);
+            out.write((const char*)&header, sizeof(header));
+            bool ok = header.item_size == 4
+                ? write_items<uint32_t>(out, positions) && write_items<uint32_t>(out, pairs)
+                : write_items<uint64_t>(out, positions) && write_items<uint64_t>(out, pairs);
+            if (!ok || !out.flush()) {
+                out.close();
+                std::remove(temp_name.c_str());
+                return false;
+            }
+        }
+        if (!replace_file(temp_name, file_name)) {
+            std::remove(temp_name.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool structural_index::load(const std::string& file_name, const char* data, size_t length, const std::string& source_file_name)
+    {
+        positions.clear();
+        pairs.clear();
+        max_depth = 0;
+        error_pos = npos;
+        error_text.clear();
+        std::ifstream in(file_name, std::ios::binary);
+        snapshot_header header;
+        if (!in.read((char*)&header, sizeof(header))
+            || std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0
+            || header.version != snapshot_version
+            || (header.item_size != 4 && header.item_size != 8)
+            || header.item_size > sizeof(size_t)
+            || header.byte_order != byte_order_mark
+            || header.data_length != length
+            || header.count > length)
+            return false;
+        // The data is hashed only if its source file is unknown or changed.
+        auto stamp = get_source_stamp(source_file_name);
+        bool is_same_source = stamp.time != 0 && stamp.size == header.source_size && stamp.time == header.source_time;
+        if (!is_same_source && header.data_hash != content_hash(data, length))
+            return false;
+        size_t count = size_t(header.count);
+        bool ok = header.item_size == 4
+            ? read_items<uint32_t>(in, positions, count) && read_items<uint32_t>(in, pairs, count)
+            : read_items<uint64_t>(in, positions, count) && read_items<uint64_t>(in, pairs, count);
+        // Readers jump by the index without checks, so it must point to the structural characters of the data
+        // and pair properly nested matching brackets.
+        std::vector<size_t> opens;
+        for (size_t i = 0; ok && i < count; i++) {
+            ok = positions[i] < length && (i == 0 || positions[i - 1] < positions[i]);
+            if (!ok)
+                break;
+            auto c = (unsigned char)data[positions[i]];
+            if (c == ',') {
+                ok = pairs[i] == npos;
+            } else if (is_open(c)) {
+                ok = pairs[i] != npos && pairs[i] > i && pairs[i] < count;
+                opens.push_back(i);
+                max_depth = std::max(max_depth, opens.size());
+            } else if (c == ']' || c == '}') {
+                ok = !opens.empty()
+                    && pairs[i] == opens.back()
+                    && pairs[opens.back()] == i
+                    && closing(data[positions[opens.back()]]) == c;
+                if (ok)
+                    opens.pop_back();
+            } else {
+                ok = false;
+            }
+        }
+        if (!ok || !opens.empty() || in.peek() != std::ifstream::traits_type::eof()) {
+            max_depth = 0;
+            positions.clear();
+            pairs.clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool structural_index::build_cached(
+        const std::string& file_name,
+        const char* data,
+        size_t length,
+        thread_pool* pool,
+        size_t chunk_size)
+    {
+        return build_cached(file_name, std::string(), data, length, pool, chunk_size);
+    }
+
+    bool structural_index::build_cached(
+        const std::string& file_name,
+        const std::string& source_file_name,
+        const char* data,
+        size_t length,
+        thread_pool* pool,
+        size_t chunk_size)
+    {
+        if (load(file_name, data, length, source_file_name))
+            return true;
+        if (!build(data, length, pool, chunk_size))
+            return false;
+        save(file_name, data, length, source_file_name);
+        return true;
+    }
+
+    uint64_t content_hash(const char* data, size_t length)
+    {
+        const uint64_t k = 0x9e3779b97f4a7c15;
+        uint64_t h = length * k;
+        auto mix = [&](uint64_t word) {
+            h ^= word;
+            h = (h << 29 | h >> 35) * k;
+        };
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            mix(word);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, data + i, length - i);
+        mix(tail);
+        return h ^ h >> 32;
+    }
+}
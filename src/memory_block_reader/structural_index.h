@@ -0,0 +1,106 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_STRUCTURAL_INDEX_H
+#define REACTIVE_JSON_STRUCTURAL_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../thread_pool/thread_pool.h"
+
+namespace reactive_json
+{
+    /// Positions of all brackets and commas of a JSON data block (outside strings)
+    /// with matching pairs of brackets.
+    /// It allows `memory_block_reader` to skip arrays and objects in one jump.
+    /// It can be built on multiple threads: each thread scans its own chunk,
+    /// the in-string state at chunk boundaries is fixed up by a prefix pass over the chunk quote parities,
+    /// and per-chunk bracket matches are merged into one global index.
+    /// The index is immutable after `build`, so it can be shared by any number of readers.
+    struct structural_index
+    {
+        static constexpr size_t npos = ~size_t(0);
+
+        /// Offsets of `{`, `}`, `[`, `]`, `,` outside strings in the document order.
+        std::vector<size_t> positions;
+
+        /// For each bracket in `positions` - the index of its matching bracket in `positions`.
+        /// For commas - `npos`.
+        std::vector<size_t> pairs;
+
+        /// The maximum nesting of arrays and objects in the document.
+        size_t max_depth = 0;
+
+        /// Builds the index for the `length` bytes of `data`.
+        /// If `pool` is given, the data is split in chunks of at least `chunk_size` bytes scanned by the pool threads.
+        /// Returns false on unterminated strings and unbalanced or mismatched brackets,
+        /// in this case `get_error_pos` and `get_error_message` describe the first found error.
+        bool build(const char* data, size_t length, thread_pool* pool = nullptr, size_t chunk_size = 1 << 20);
+
+        /// Returns the index in `positions` of the structural character at the given offset, or `npos`.
+        size_t find(size_t offset) const;
+
+        /// Writes the successfully built index for the `length` bytes of `data` to a binary snapshot file.
+        /// The snapshot contains only offsets, so it can be used with the same data at any address,
+        /// and it is keyed by the data size and `content_hash`, so it can't be loaded for different data.
+        /// If the data was read from the `source_file_name`, the snapshot also records its size and modification time.
+        /// Returns false on I/O errors.
+        bool save(const std::string& file_name, const char* data, size_t length, const std::string& source_file_name = {}) const;
+
+        /// Loads the index from a snapshot written by `save` for the same `length` bytes of `data`.
+        /// If the `source_file_name` has the size and modification time recorded by `save`,
+        /// the data is not hashed, otherwise `content_hash` of the data must match.
+        /// The loaded positions are checked to be structural characters of the data with properly nested bracket pairs.
+        /// Returns false if the file is absent, damaged, made on a platform with a different `size_t`,
+        /// or made for different data; in this case the index is left empty.
+        bool load(const std::string& file_name, const char* data, size_t length, const std::string& source_file_name = {});
+
+        /// Loads the index from the snapshot file if it matches the data, otherwise builds it and writes a new snapshot.
+        /// Returns false if the data is malformed (see `build`), failures to write the snapshot are ignored.
+        /// Example: `index.build_cached(catalog_file_name + ".idx", data.data(), data.size(), &pool);`
+        bool build_cached(
+            const std::string& file_name,
+            const char* data,
+            size_t length,
+            thread_pool* pool = nullptr,
+            size_t chunk_size = 1 << 20);
+
+        /// Same as above for the data read from the `source_file_name`,
+        /// the snapshot is matched by the size and modification time of that file without hashing the data.
+        /// Example: `index.build_cached(catalog_file_name + ".idx", catalog_file_name, data.data(), data.size(), &pool);`
+        bool build_cached(
+            const std::string& file_name,
+            const std::string& source_file_name,
+            const char* data,
+            size_t length,
+            thread_pool* pool = nullptr,
+            size_t chunk_size = 1 << 20);
+
+        // Returns error offset in the indexed data or `npos` if there is no error.
+        size_t get_error_pos() const { return error_pos; }
+
+        // Returns error text or an empty string if no error.
+        const std::string& get_error_message() const { return error_text; }
+
+    private:
+        size_t error_pos = npos;
+        std::string error_text;
+    };
+
+    /// Non-cryptographic 64-bit hash of the `length` bytes of `data`, it detects changes of the indexed data.
+    uint64_t content_hash(const char* data, size_t length);
+}
+
+#endif  // REACTIVE_JSON_STRUCTURAL_INDEX_H
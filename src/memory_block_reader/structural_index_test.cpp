@@ -0,0 +1,226 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "structural_index.h"
+#include "memory_block_reader.h"
+#include "gunit.h"
+
+namespace
+{
+    const char* document = R"-({"a": [1, 2, {"b": "x,]}[\"\\"}], "c\"": {"d": [[], {}]},
+        "e": "\\\\", "f": [{"g": "]\\\\\""}, 3]})-";
+
+    TEST(StructuralIndex, ChunksMatchSequentialScan)
+    {
+        size_t length = strlen(document);
+        reactive_json::structural_index sequential;
+        ASSERT_TRUE(sequential.build(document, length));
+        ASSERT_EQ(sequential.positions.size(), 25);
+        ASSERT_EQ(sequential.pairs[0], sequential.positions.size() - 1);
+        reactive_json::thread_pool pool(3);
+        for (size_t chunk_size = 1; chunk_size < 20; chunk_size++) {
+            reactive_json::structural_index parallel;
+            ASSERT_TRUE(parallel.build(document, length, &pool, chunk_size));
+            ASSERT_TRUE(parallel.positions == sequential.positions);
+            ASSERT_TRUE(parallel.pairs == sequential.pairs);
+        }
+    }
+
+    TEST(StructuralIndex, Errors)
+    {
+        reactive_json::thread_pool pool(2);
+        for (size_t chunk_size : { 1, 3, 100 }) {
+            reactive_json::structural_index index;
+            ASSERT_FALSE(index.build(R"-([{"a": 1]})-", 11, &pool, chunk_size));
+            ASSERT_EQ(index.get_error_pos(), 8);
+            ASSERT_FALSE(index.build(R"-([1, 2)-", 5, &pool, chunk_size));
+            ASSERT_EQ(index.get_error_message(), "incomplete array");
+            ASSERT_FALSE(index.build(R"-(["a\"])-", 7, &pool, chunk_size));
+            ASSERT_EQ(index.get_error_message(), "incomplete string");
+            ASSERT_FALSE(index.build(R"-([1]])-", 4, &pool, chunk_size));
+            ASSERT_EQ(index.get_error_message(), "mismatched ]");
+        }
+    }
+
+    TEST(StructuralIndex, IndexedSkipping)
+    {
+        reactive_json::structural_index index;
+        ASSERT_TRUE(index.build(document, strlen(document)));
+        reactive_json::memory_block_reader json(document);
+        json.set_index(&index);
+        std::string e;
+        json.get_object([&](auto name) {
+            if (name == "e")
+                e = json.get_string("");
+        });
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(e, "\\\\");
+    }
+
+    TEST(StructuralIndex, IndexedDepthLimit)
+    {
+        const char* data = R"-({"a": [[[1]]], "b": 2})-";
+        reactive_json::structural_index index;
+        ASSERT_TRUE(index.build(data, strlen(data)));
+        ASSERT_EQ(index.max_depth, 4);
+        reactive_json::reader_limits limits;
+        limits.max_depth = 3;
+        reactive_json::memory_block_reader json(data);
+        json.set_limits(limits);
+        json.set_index(&index);
+        json.get_object([&](auto) { json.skip(); });
+        ASSERT_EQ(json.get_error_message(), "max depth exceeded");
+        limits.max_depth = 4;
+        json.reset(data);
+        json.set_limits(limits);
+        json.set_index(&index);
+        json.get_object([&](auto) { json.skip(); });
+        ASSERT_TRUE(json.success());
+    }
+
+    TEST(StructuralIndex, IndexedSeek)
+    {
+        reactive_json::structural_index index;
+        ASSERT_TRUE(index.build(document, strlen(document)));
+        reactive_json::memory_block_reader json(document);
+        json.set_index(&index);
+        ASSERT_TRUE(json.seek("/f/1"));
+        ASSERT_EQ(json.get_number(0), 3);
+        json.reset(document);
+        json.set_index(&index);
+        ASSERT_TRUE(json.seek("/c\"/d/1"));
+        ASSERT_TRUE(json.try_object([](auto) {}));
+    }
+
+    TEST(StructuralIndex, IndexedCount)
+    {
+        reactive_json::structural_index index;
+        ASSERT_TRUE(index.build(document, strlen(document)));
+        reactive_json::memory_block_reader json(document);
+        json.set_index(&index);
+        ASSERT_TRUE(json.seek("/a"));
+        ASSERT_EQ(json.count_array_items(), 3);
+        json.reset(document);
+        json.set_index(&index);
+        ASSERT_TRUE(json.seek("/c\"/d/0"));
+        ASSERT_EQ(json.count_array_items(), 0);
+    }
+
+    TEST(StructuralIndex, Snapshot)
+    {
+        size_t length = strlen(document);
+        std::string file_name = "structural_index_test.idx";
+        std::remove(file_name.c_str());
+        reactive_json::structural_index built;
+        ASSERT_TRUE(built.build_cached(file_name, document, length));
+        reactive_json::structural_index loaded;
+        ASSERT_TRUE(loaded.load(file_name, document, length));
+        ASSERT_TRUE(loaded.positions == built.positions);
+        ASSERT_TRUE(loaded.pairs == built.pairs);
+
+        // The snapshot is relocatable: it works with a copy of the data at another address.
+        std::string copy = document;
+        reactive_json::memory_block_reader json(copy.data(), copy.size());
+        json.set_index(&loaded);
+        ASSERT_TRUE(json.seek("/f/1"));
+        ASSERT_EQ(json.get_number(0), 3);
+
+        copy[copy.find("3]")] = '4';
+        ASSERT_FALSE(loaded.load(file_name, copy.data(), copy.size()));
+        ASSERT_EQ(loaded.positions.size(), 0);
+        ASSERT_FALSE(loaded.load(file_name, document, length - 1));
+        {
+            std::ofstream(file_name, std::ios::binary | std::ios::app) << "x";
+        }
+        ASSERT_FALSE(loaded.load(file_name, document, length));
+        ASSERT_TRUE(loaded.build_cached(file_name, document, length));
+        ASSERT_TRUE(loaded.load(file_name, document, length));
+        std::remove(file_name.c_str());
+        ASSERT_FALSE(loaded.build_cached(file_name, "[1, 2", 5));
+        ASSERT_FALSE(loaded.load(file_name, "[1, 2", 5));
+    }
+
+    TEST(StructuralIndex, SnapshotOfSourceFile)
+    {
+        size_t length = strlen(document);
+        std::string source_file_name = "structural_index_source_test.json";
+        std::string file_name = "structural_index_source_test.idx";
+        {
+            std::ofstream(source_file_name, std::ios::binary) << document;
+        }
+        std::remove(file_name.c_str());
+        reactive_json::structural_index built;
+        ASSERT_TRUE(built.build_cached(file_name, source_file_name, document, length));
+
+        // The unchanged source file stands for the data, so it is not hashed: an edit of the same size goes unnoticed.
+        std::string copy = document;
+        copy[copy.find("3]")] = '4';
+        reactive_json::structural_index loaded;
+        ASSERT_TRUE(loaded.load(file_name, copy.data(), copy.size(), source_file_name));
+        ASSERT_TRUE(loaded.positions == built.positions);
+        ASSERT_FALSE(loaded.load(file_name, copy.data(), copy.size()));
+        ASSERT_FALSE(loaded.load(file_name, copy.data(), copy.size(), "structural_index_missing_test.json"));
+        ASSERT_TRUE(loaded.load(file_name, document, length, "structural_index_missing_test.json"));
+        std::remove(source_file_name.c_str());
+        std::remove(file_name.c_str());
+    }
+
+    TEST(StructuralIndex, SnapshotStructureChecked)
+    {
+        const char* data = "[[1],[2]]";
+        size_t length = strlen(data);
+        std::string file_name = "structural_index_structure_test.idx";
+        reactive_json::structural_index index;
+        ASSERT_TRUE(index.build(data, length));
+        reactive_json::structural_index loaded;
+        ASSERT_TRUE(index.save(file_name, data, length));
+        ASSERT_TRUE(loaded.load(file_name, data, length));
+        ASSERT_EQ(loaded.max_depth, 2);
+
+        // Crossed pairs still point to each other.
+        auto crossed = index;
+        crossed.pairs[1] = 5;
+        crossed.pairs[5] = 1;
+        crossed.pairs[4] = 2;
+        crossed.pairs[2] = 4;
+        ASSERT_TRUE(crossed.save(file_name, data, length));
+        ASSERT_FALSE(loaded.load(file_name, data, length));
+        ASSERT_EQ(loaded.positions.size(), 0);
+
+        auto misplaced = index;
+        misplaced.positions[2] = 2;
+        ASSERT_TRUE(misplaced.save(file_name, data, length));
+        ASSERT_FALSE(loaded.load(file_name, data, length));
+
+        auto unpaired = index;
+        unpaired.pairs[0] = reactive_json::structural_index::npos;
+        unpaired.pairs[6] = reactive_json::structural_index::npos;
+        ASSERT_TRUE(unpaired.save(file_name, data, length));
+        ASSERT_FALSE(loaded.load(file_name, data, length));
+        std::remove(file_name.c_str());
+    }
+
+    TEST(StructuralIndex, ConcurrentSnapshots)
+    {
+        size_t length = strlen(document);
+        std::string file_name = "structural_index_concurrent_test.idx";
+        reactive_json::structural_index index;
+        ASSERT_TRUE(index.build(document, length));
+        // Each writer uses its own temporary file, so concurrent saves don't clobber each other.
+        std::vector<std::thread> writers;
+        bool is_saved[4]{};
+        for (auto& saved : is_saved)
+            writers.emplace_back([&] { saved = index.save(file_name, document, length); });
+        for (auto& w : writers)
+            w.join();
+        for (bool saved : is_saved)
+            ASSERT_TRUE(saved);
+        reactive_json::structural_index loaded;
+        ASSERT_TRUE(loaded.load(file_name, document, length));
+        ASSERT_TRUE(index.save(file_name, document, length));
+        ASSERT_TRUE(loaded.load(file_name, document, length));
+        std::remove(file_name.c_str());
+    }
+}
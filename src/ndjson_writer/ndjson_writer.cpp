@@ -0,0 +1,222 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <vector>
+
+#include "ndjson_writer.h"
+
+namespace reactive_json
+{
+    namespace
+    {
+        // Stream buffer that appends to a string, it keeps its capacity between records.
+        class string_buffer : public std::streambuf
+        {
+        public:
+            std::string text;
+
+        protected:
+            int_type overflow(int_type c) override
+            {
+                if (!traits_type::eq_int_type(c, traits_type::eof()))
+                    text.push_back(traits_type::to_char_type(c));
+                return traits_type::not_eof(c);
+            }
+
+            std::streamsize xsputn(const char* s, std::streamsize n) override
+            {
+                text.append(s, size_t(n));
+                return n;
+            }
+        };
+
+        struct record_buffer {
+            string_buffer buffer;
+            std::ostream stream{ &buffer };
+        };
+    }
+
+    // Per-thread formatting buffers, one for each nesting level of `write` calls,
+    // and records taken from `free_records` of any writer.
+    // Records don't belong to writers, so they can be used with any writer and outlive them.
+    struct ndjson_writer::thread_state
+    {
+        std::vector<std::unique_ptr<record_buffer>> buffers;
+        size_t depth = 0;
+        record* spare = nullptr;
+
+        ~thread_state()
+        {
+            while (auto r = spare) {
+                spare = r->next;
+                delete r;
+            }
+        }
+    };
+
+    ndjson_writer::thread_state& ndjson_writer::local()
+    {
+        thread_local thread_state state;
+        return state;
+    }
+
+    ndjson_writer::ndjson_writer(std::unique_ptr<std::ostream> sink, size_t batch_size)
+        : holder(std::move(sink))
+        , sink(*holder)
+        , flags(this->sink.flags())
+        , precision(this->sink.precision())
+        , batch_size(batch_size)
+        , flusher([this] { flush_loop(); })
+    {}
+
+    ndjson_writer::ndjson_writer(std::ostream& sink, size_t batch_size)
+        : sink(sink)
+        , flags(sink.flags())
+        , precision(sink.precision())
+        , batch_size(batch_size)
+        , flusher([this] { flush_loop(); })
+    {}
+
+    ndjson_writer::~ndjson_writer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        has_records.notify_one();
+        flusher.join();
+        for (auto r = free_records.exchange(nullptr); r;) {
+            auto next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    std::ostream& ndjson_writer::begin_record()
+    {
+        auto& state = local();
+        if (state.depth == state.buffers.size())
+            state.buffers.push_back(std::make_unique<record_buffer>());
+        auto& local_record = *state.buffers[state.depth++];
+        local_record.buffer.text.clear();
+        local_record.stream.clear();
+        local_record.stream.flags(flags);
+        local_record.stream.precision(precision);
+        return local_record.stream;
+    }
+
+    void ndjson_writer::cancel_record()
+    {
+        local().depth--;
+    }
+
+    ndjson_writer::record* ndjson_writer::take_free_record(thread_state& state)
+    {
+        // Producers take the whole free list at once, so there is no ABA problem with concurrent pops.
+        if (!state.spare)
+            state.spare = free_records.exchange(nullptr, std::memory_order_acquire);
+        auto r = state.spare;
+        if (!r)
+            return new record{ {}, nullptr };
+        state.spare = r->next;
+        return r;
+    }
+
+    void ndjson_writer::publish_record()
+    {
+        auto& state = local();
+        auto& text = state.buffers[--state.depth]->buffer.text;
+        text.push_back('\n');
+        auto r = take_free_record(state);
+        r->text.swap(text);  // the buffer gets the capacity of the reused record
+        // Counted before linking: records linked after this one are taken by the flusher together with it,
+        // so a `flush` that counts this record can't see its target reached by other records alone.
+        published_count.fetch_add(1, std::memory_order_release);
+        auto head = published.load(std::memory_order_relaxed);
+        do
+            r->next = head;
+        while (!published.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+        if (!head) {
+            // Taking the mutex guarantees that the flusher is either waiting or hasn't checked `published` yet.
+            { std::lock_guard<std::mutex> lock(mutex); }
+            has_records.notify_one();
+        }
+    }
+
+    void ndjson_writer::flush()
+    {
+        size_t target = published_count.load(std::memory_order_acquire);
+        has_records.notify_one();
+        std::unique_lock<std::mutex> lock(mutex);
+        has_written.wait(lock, [&] { return written_count >= target; });
+    }
+
+    void ndjson_writer::flush_loop()
+    {
+        for (;;) {
+            if (auto list = published.exchange(nullptr, std::memory_order_acquire)) {
+                write_records(list);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            if (stopping && !published.load(std::memory_order_acquire))
+                return;
+            has_records.wait(lock, [&] {
+                return stopping || published.load(std::memory_order_relaxed);
+            });
+        }
+    }
+
+    void ndjson_writer::write_records(record* list)
+    {
+        record* in_order = nullptr;
+        record* last = list;
+        size_t count = 0;
+        while (list) {
+            auto next = list->next;
+            list->next = in_order;
+            in_order = list;
+            list = next;
+            count++;
+        }
+        for (auto r = in_order; r; r = r->next) {
+            if (batch.empty() && r->text.size() >= batch_size) {
+                sink.write(r->text.data(), r->text.size());
+            } else {
+                batch += r->text;
+                if (batch.size() >= batch_size) {
+                    sink.write(batch.data(), batch.size());
+                    batch.clear();
+                }
+            }
+            if (r->text.capacity() > batch_size)
+                r->text = std::string();  // don't keep memory of rare huge records
+        }
+        if (!batch.empty()) {
+            sink.write(batch.data(), batch.size());
+            batch.clear();
+        }
+        sink.flush();
+
+        // Producers only take the whole free list, so pushing the chain with CAS is safe.
+        auto head = free_records.load(std::memory_order_relaxed);
+        do
+            last->next = head;
+        while (!free_records.compare_exchange_weak(head, in_order, std::memory_order_release, std::memory_order_relaxed));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written_count += count;
+        }
+        has_written.notify_all();
+    }
+}
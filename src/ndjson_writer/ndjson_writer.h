@@ -0,0 +1,112 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_NDJSON_WRITER_H
+#define REACTIVE_JSON_NDJSON_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "../writer/writer.h"
+
+namespace reactive_json
+{
+    /// Outputs newline-delimited JSON records produced concurrently by any number of threads.
+    /// Each thread formats its record with the regular `writer` API into its own thread-local buffer,
+    /// and publishes the completed record to a lock-free queue.
+    /// A single background flusher thread takes all published records at once
+    /// and writes them to the sink in large batches.
+    /// Producers don't wait for each other or for the sink, they only take a short lock to wake up the idle flusher.
+    /// Records from the same thread appear in the output in the order they were written,
+    /// records from different threads are interleaved in the publishing order.
+    class ndjson_writer
+    {
+    public:
+        /// Constructs writer that owns the underlined stream.
+        /// `batch_size` defines the amount of bytes collected before each `write` to the sink.
+        explicit ndjson_writer(std::unique_ptr<std::ostream> sink, size_t batch_size = 1 << 16);
+
+        /// Constructs writer that borrows the underlined stream.
+        explicit ndjson_writer(std::ostream& sink, size_t batch_size = 1 << 16);
+
+        /// Writes all published records and stops the flusher thread.
+        ~ndjson_writer();
+
+        ndjson_writer(const ndjson_writer&) = delete;
+        ndjson_writer& operator= (const ndjson_writer&) = delete;
+
+        /// Outputs one record.
+        /// `on_record` is a lambda that receives a `writer&` and must write exactly one JSON value with it.
+        /// Can be called from any thread, and from `on_record` of another record (of this or any other `ndjson_writer`).
+        /// Example:
+        /// ndjson_writer log(std::cout);
+        /// log.write([&](auto& writer) {
+        ///     writer.write_object([&](auto fields) {
+        ///         fields("event", "login")("user", user_name);
+        ///     });
+        /// });
+        template<typename ON_RECORD>
+        void write(ON_RECORD&& on_record)
+        {
+            writer record(begin_record());
+            try {
+                on_record(record);
+            } catch (...) {
+                cancel_record();
+                throw;
+            }
+            publish_record();
+        }
+
+        /// Blocks until all records published before this call are passed to the sink.
+        void flush();
+
+    private:
+        struct record {
+            std::string text;
+            record* next;
+        };
+        struct thread_state;
+
+        static thread_state& local();
+        std::ostream& begin_record();
+        void publish_record();
+        void cancel_record();
+        record* take_free_record(thread_state& state);
+        void flush_loop();
+        void write_records(record* list);
+
+        std::unique_ptr<std::ostream> holder;
+        std::ostream& sink;
+        std::ios_base::fmtflags flags;
+        std::streamsize precision;
+        size_t batch_size;
+        std::atomic<record*> published{ nullptr };  // LIFO list of records not yet taken by the flusher
+        std::atomic<size_t> published_count{ 0 };  // counted before linking, so it never lags behind the written records
+        std::atomic<record*> free_records{ nullptr };  // written records to be reused by producers
+        size_t written_count = 0;
+        std::string batch;  // used only by the flusher thread
+        std::mutex mutex;
+        std::condition_variable has_records;
+        std::condition_variable has_written;
+        bool stopping = false;
+        std::thread flusher;
+    };
+}
+
+#endif  // REACTIVE_JSON_NDJSON_WRITER_H
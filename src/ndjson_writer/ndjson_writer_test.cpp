@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ndjson_writer.h"
+#include "../memory_block_reader/memory_block_reader.h"
+#include "gunit.h"
+
+namespace
+{
+    // Sink that can be inspected while the flusher writes to it.
+    class shared_buffer : public std::streambuf
+    {
+    public:
+        bool contains(const std::string& line)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return text.find(line) != std::string::npos;
+        }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            char ch = traits_type::to_char_type(c);
+            return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            text.append(s, size_t(n));
+            return n;
+        }
+
+    private:
+        std::mutex mutex;
+        std::string text;
+    };
+
+    TEST(NdjsonWriter, ConcurrentProducers)
+    {
+        const int threads_count = 4, records_count = 2000;
+        std::stringstream out;
+        {
+            reactive_json::ndjson_writer log(out, 256);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threads_count; t++) {
+                threads.emplace_back([&, t] {
+                    for (int i = 0; i < records_count; i++) {
+                        log.write([&](auto& writer) {
+                            writer.write_object([&](auto fields) {
+                                fields("thread", double(t))("seq", double(i))("text", "a\nb");
+                            });
+                        });
+                    }
+                });
+            }
+            for (auto& t : threads)
+                t.join();
+            log.flush();
+            auto text = out.str();
+            ASSERT_EQ(std::count(text.begin(), text.end(), '\n'), threads_count * records_count);
+        }
+        std::vector<int> next_seq(threads_count, 0);
+        std::string line;
+        while (std::getline(out, line)) {
+            reactive_json::memory_block_reader json(line.c_str());
+            int thread = -1, seq = -1;
+            json.get_object([&](auto name) {
+                if (name == "thread") thread = (int)json.get_number(-1);
+                else if (name == "seq") seq = (int)json.get_number(-1);
+            });
+            ASSERT_TRUE(json.success());
+            ASSERT_EQ(seq, next_seq[thread]++);
+        }
+        for (auto n : next_seq)
+            ASSERT_EQ(n, records_count);
+    }
+
+    TEST(NdjsonWriter, NestedRecords)
+    {
+        std::stringstream first_out, second_out;
+        {
+            reactive_json::ndjson_writer first(first_out), second(second_out);
+            for (int i = 0; i < 3; i++) {
+                first.write([&](auto& writer) {
+                    writer.write_object([&](auto fields) {
+                        fields("a", double(i));
+                        // Records of both writers are formatted in separate buffers.
+                        second.write([&](auto& writer) { writer(double(i * 10)); });
+                        first.write([&](auto& writer) { writer("inner"); });
+                        fields("b", true);
+                    });
+                });
+            }
+        }
+        ASSERT_EQ(second_out.str(), "0\n10\n20\n");
+        ASSERT_EQ(first_out.str(),
+            "\"inner\"\n{\"a\":0,\"b\":true}\n\"inner\"\n{\"a\":1,\"b\":true}\n\"inner\"\n{\"a\":2,\"b\":true}\n");
+    }
+
+    TEST(NdjsonWriter, FlushWaitsForOwnRecord)
+    {
+        shared_buffer buffer;
+        std::ostream out(&buffer);
+        reactive_json::ndjson_writer log(out, 16);
+        std::vector<std::thread> threads;
+        bool is_flushed[4] = { true, true, true, true };
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 500; i++) {
+                    auto text = std::to_string(t) + "-" + std::to_string(i);
+                    log.write([&](auto& writer) { writer(text.c_str()); });
+                    log.flush();
+                    is_flushed[t] &= buffer.contains("\"" + text + "\"\n");
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        for (bool flushed : is_flushed)
+            ASSERT_TRUE(flushed);
+    }
+}
@@ -0,0 +1,447 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_READER_CORE_H
+#define REACTIVE_JSON_READER_CORE_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../reader_limits/reader_limits.h"
+
+namespace reactive_json
+{
+    /// Converts a parsed JSON number to the arithmetic type `T`.
+    /// Returns an error message and leaves the `result` intact if the number doesn't fit `T`:
+    /// for integer types it must be an integer in the type range, for `float` it must not exceed its range.
+    template<typename T>
+    const char* convert_number(double value, T& result)
+    {
+        if constexpr (std::is_integral_v<T>) {
+            if (std::trunc(value) != value)
+                return "expected integer";
+            const double upper = std::ldexp(1.0, std::numeric_limits<T>::digits);
+            if (value >= upper || value < (std::is_signed_v<T> ? -upper : 0.0))
+                return "integer out of range";
+        } else if constexpr (sizeof(T) < sizeof(double)) {
+            if (std::isfinite(value) && std::fabs(value) > double(std::numeric_limits<T>::max()))
+                return "number out of range";
+        }
+        result = static_cast<T>(value);
+        return nullptr;
+    }
+
+    /// Parsing logic shared by all readers.
+    /// It is a base class parameterized by the derived reader, that acts as an input policy and provides:
+    /// - `unsigned char peek()` - the current character, or 0 at the end of data and in the error state,
+    /// - `void next()` - advances to the next character,
+    /// - `position()` - a non-zero value, that grows as data is consumed,
+    /// - `bool has_error()`, `set_error`, `skip_ws`, `skip_string` (called after the opening quote) and `skip_value`,
+    /// - `void end_value()` - a validation hook called after each parsed array and object,
+    /// - `get_number`, `get_bool`, `get_string` and `try_string`.
+    /// All these calls are resolved and inlined at compile time,
+    /// so each reader gets the same code as if it was written by hand for its input.
+    template<typename READER>
+    class reader_core
+    {
+    public:
+        /// Attempts to extract an array from the current position.
+        /// If current position contains an array:
+        /// - returns true,
+        /// - calls `on_item` for each array element.
+        /// - and advances the position.
+        /// Otherwise:
+        /// - leaves the current position intact
+        /// - returns false.
+        /// The `on_array` handler is a `void()` lambda, that is invoked on each array item.
+        /// It must call any reader methods to extract the array item data.
+        /// Example:
+        /// memory_block_reader json("[1,2,3,4]");
+        /// std::vector<double> result;
+        /// bool it_was_array = json.try_array([&]{
+        ///     result.push_back(json.get_number(0));
+        /// });
+        /// If the array is malformed, the reader switches to the error state.
+        template<typename ON_ITEM>
+        bool try_array(ON_ITEM on_item)
+        {
+            if (!is('['))
+                return false;
+            nesting_guard nesting(*this);
+            if (is(']') || self().has_error())
+                return true;
+            do
+                on_item();
+            while (is(','));
+            if (!is(']'))
+                self().set_error("expected ',' or ']'");
+            self().end_value();
+            return true;
+        }
+
+        /// Extracts an array from the current position.
+        /// If the current position contains an array it calls `on_item` for each array element.
+        /// Alway skips current json element.
+        /// The `on_array` handler is a `void()` lambda, that must call any reader methods to extract the array item data.
+        /// Example:
+        /// memory_block_reader json("[1,2,3,4]");
+        /// std::vector<double> result;
+        /// json.get_array([&]{
+        ///     result.push_back(json.get_number(0));
+        /// });
+        /// If the array is malformed, the reader switches to the error state.
+        template<typename ON_ITEM>
+        void get_array(ON_ITEM on_item)
+        {
+            if (!try_array(std::move(on_item)))
+                self().skip_value();
+        }
+
+        /// Attempts to extract a fixed-size array of items of the given types, like `[x, y]` or `["id", 1, true]`.
+        /// Item types can be arithmetic, `bool` or `std::string`, items of other JSON types are skipped and get default values.
+        /// Numbers that don't fit their item types switch the reader to the error state (see `convert_number`).
+        /// If the current position contains an array:
+        /// - returns the tuple of items,
+        /// - advances the position,
+        /// - if the array size differs from the number of types, the reader switches to the error state
+        ///   "expected N array items".
+        /// Otherwise leaves the current position intact and returns nullopt.
+        /// Items are read by the code unrolled at compile time, without per-item lambda calls.
+        /// Example:
+        /// memory_block_reader json("[1.5, 2, \"north\"]");
+        /// auto [lat, lon, name] = *json.try_tuple<double, double, std::string>();
+        template<typename... T>
+        std::optional<std::tuple<T...>> try_tuple()
+        {
+            if (!is('['))
+                return std::nullopt;
+            nesting_guard nesting(*this);
+            std::tuple<T...> result{};
+            read_fixed_items(result, std::index_sequence_for<T...>());
+            end_fixed_array(sizeof...(T));
+            return result;
+        }
+
+        /// Extracts a fixed-size array of items of the given types, see `try_tuple`.
+        /// If the current position doesn't contain an array, skips it and returns a tuple of default values.
+        template<typename... T>
+        std::tuple<T...> get_tuple()
+        {
+            auto r = try_tuple<T...>();
+            return r ? std::move(*r) : (self().skip_value(), std::tuple<T...>{});
+        }
+
+        /// Attempts to extract an array of exactly N items to the `result`, see `try_tuple`.
+        /// Like in `try_tuple` the item reads are unrolled at compile time.
+        /// Returns false and leaves the position intact if the current position doesn't contain an array.
+        /// Example:
+        /// std::array<double, 3> xyz;
+        /// json.try_fixed_array(xyz);
+        template<typename T, size_t N>
+        bool try_fixed_array(std::array<T, N>& result)
+        {
+            if (!is('['))
+                return false;
+            nesting_guard nesting(*this);
+            read_fixed_items(result, std::make_index_sequence<N>());
+            end_fixed_array(N);
+            return true;
+        }
+
+        /// Attempts to extract an object from the current position.
+        /// If the current position contains an object:
+        /// - returns true,
+        /// - calls `on_field` for each field.
+        /// - advances the position past the object.
+        /// Otherwise:
+        /// - leaves the current position intact
+        /// - returns false.
+        /// The `on_field` handler is a `void(std::string field_name)` lambda, that:
+        /// - receives the field name as a string,
+        /// - can use any any reader methods to access the field data.
+        /// Example:
+        /// memory_block_reader json(R"-( { "x": 1, "y": "hello" } )-");
+        /// std::pair<double, std::string> result;
+        /// bool it_was_object = json.try_object([&] (auto name){
+        ///     if (name == "x") result.first = json.get_number(0);
+        ///     else if (name == "y") result.second = json.get_string("");
+        /// });
+        /// If the object is malformed, the reader switches to the error state.
+        template<typename ON_FIELD>
+        bool try_object(ON_FIELD on_field)
+        {
+            if (!is('{'))
+                return false;
+            nesting_guard nesting(*this);
+            std::string field_name;
+            if (auto p = handle_object_start(field_name))
+            {
+                do
+                    on_field(std::move(field_name));
+                while (handle_object_cont(field_name, p));
+            }
+            return true;
+        }
+
+        /// Extracts an object from the current position.
+        /// If the current position contains an object, calls `on_field` for each field.
+        /// Skips current json element.
+        /// The `on_field` handler is a `void(std::string field_name)` lambda, that:
+        /// - reseives the field name as a string,
+        /// - can use any any reader methods to access the field data.
+        /// Example:
+        /// memory_block_reader json(R"-( { "x": 1, "y": "hello" } )-");
+        /// std::pair<double, std::string> result;
+        /// json.get_object([&] (auto name){
+        ///     if (name == "x") result.first = json.get_number(0);
+        ///     else if (name == "y") result.second = json.get_string("");
+        /// });
+        /// If the object is malformed, the reader switches to the error state.
+        template<typename ON_FIELD>
+        void get_object(ON_FIELD on_field)
+        {
+            if (!try_object(std::move(on_field)))
+                self().skip_value();
+        }
+
+        /// Skips the current element whatever it is.
+        void skip() { self().skip_value(); }
+
+        /// Returns the number of arrays and objects containing the current element.
+        size_t get_depth() const { return depth; }
+
+    protected:
+        // Tracks the nesting depth of arrays and objects being parsed.
+        struct nesting_guard
+        {
+            reader_core& core;
+
+            nesting_guard(reader_core& core)
+                : core(core)
+            {
+                if (++core.depth > core.limits.max_depth)
+                    core.self().set_error("max depth exceeded");
+            }
+
+            ~nesting_guard() { --core.depth; }
+        };
+
+        // If the current character is `term`, skips it with the following whitespaces and returns true.
+        bool is(char term)
+        {
+            if (self().peek() != term)
+                return false;
+            self().next();
+            self().skip_ws();
+            return true;
+        }
+
+        // Skips the rest of an array or object, which opening bracket is already consumed.
+        // Not recursive: the expected closing brackets are kept in a vector.
+        void skip_until(char term)
+        {
+            std::vector<char> expects{ term };
+            auto check_depth = [&] {
+                if (depth + expects.size() <= limits.max_depth)
+                    return true;
+                self().set_error("max depth exceeded");
+                return false;
+            };
+            if (!check_depth())
+                return;
+            for (unsigned char c; (c = self().peek()) != 0;) {
+                self().next();
+                switch (c) {
+                case'"':
+                    self().skip_string();
+                    break;
+                case'[':
+                    expects.push_back(']');
+                    if (!check_depth())
+                        return;
+                    break;
+                case'{':
+                    expects.push_back('}');
+                    if (!check_depth())
+                        return;
+                    break;
+                case']':
+                case'}':
+                    if (expects.back() != c) {
+                        std::string error = "mismatched }";
+                        error.back() = c;
+                        self().set_error(error);
+                        return;
+                    }
+                    expects.pop_back();
+                    if (expects.empty()) {
+                        self().skip_ws();
+                        return;
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+            self().set_error(term == '}' ? "incomplete object" : "incomplete array");
+        }
+
+        // Reads the `\uXXXX` escape (or a surrogate pair of them) at the current `u` character.
+        bool get_codepoint(uint32_t& val)
+        {
+            auto get_utf16 = [&] {
+                self().next();
+                for (int i = 0; i < 4; i++, self().next()) {
+                    auto c = self().peek();
+                    if (c == 0) {
+                        self().set_error("incomplete \\uXXXX sequence");
+                        return false;
+                    }
+                    if (c >= '0' && c <= '9')
+                        val = (val << 4) | (c - '0');
+                    else if (c >= 'a' && c <= 'f')
+                        val = (val << 4) | (c - 'a' + 10);
+                    else if (c >= 'A' && c <= 'F')
+                        val = (val << 4) | (c - 'A' + 10);
+                    else {
+                        self().set_error("not a hex digit");
+                        return false;
+                    }
+                }
+                return true;
+            };
+            if (!get_utf16())
+                return false;
+            if (val >= 0xd800 && val <= 0xdbff) {
+                self().set_error("second surrogare without first one");
+                return false;
+            }
+            else if (val >= 0xdd00 && val <= 0xDFFF) {
+                auto first = val;
+                val = 0;
+                bool has_escape = self().peek() == '\\';
+                if (has_escape)
+                    self().next();
+                if (!has_escape || self().peek() != 'u') {
+                    self().set_error("first surrogare without following \\u");
+                    return false;
+                }
+                if (!get_utf16())
+                    return false;
+                if (!(val >= 0xd800 && val <= 0xdbff)) {
+                    self().set_error("first surrogare without second one");
+                    return false;
+                }
+                val = ((first & 0x3ff) << 10 | (val & 0x3ff)) + 0x10000;
+            }
+            return true;
+        }
+
+        bool handle_field_name(std::string& field_name)
+        {
+            if (!self().try_string(field_name)) {
+                self().set_error("expected field name");
+                return false;
+            }
+            if (!is(':')) {
+                self().set_error("expected ':'");
+                return false;
+            }
+            return true;
+        }
+
+        // Returns the position of the first field value, or zero if the object is empty or malformed.
+        auto handle_object_start(std::string& field_name)
+        {
+            decltype(self().position()) r{};
+            if (!is('}') && handle_field_name(field_name))
+                r = self().position();
+            return r;
+        }
+
+        // Skips the previous field value if `on_field` didn't read it, and reads the next field name.
+        template<typename POSITION>
+        bool handle_object_cont(std::string& field_name, POSITION& start_pos)
+        {
+            if (self().position() == start_pos)
+                self().skip_value();
+            if (is(',')) {
+                if (handle_field_name(field_name)) {
+                    start_pos = self().position();
+                    return true;
+                }
+            }
+            else if (!is('}'))
+                self().set_error("expected ',' or '}'");
+            self().end_value();
+            return false;
+        }
+
+        // Reads all items of a tuple or std::array, the item indexes are compile-time constants.
+        template<typename TUPLE, size_t... I>
+        void read_fixed_items(TUPLE& items, std::index_sequence<I...>)
+        {
+            (read_fixed_item(std::get<I>(items), I, sizeof...(I)), ...);
+        }
+
+        // Reads the `index` item of a fixed-size array of `size` items.
+        template<typename T>
+        void read_fixed_item(T& item, size_t index, size_t size)
+        {
+            if (self().has_error())
+                return;
+            if (index == 0 ? self().peek() == ']' : !is(',')) {
+                self().set_error(fixed_array_error(size));
+                return;
+            }
+            if constexpr (std::is_same_v<T, bool>)
+                item = self().get_bool(false);
+            else if constexpr (std::is_arithmetic_v<T>) {
+                if (auto error = convert_number(self().get_number(0), item))
+                    self().set_error(error);
+            }
+            else {
+                static_assert(std::is_same_v<T, std::string>, "fixed array items must be arithmetic, bool or std::string");
+                item = self().get_string("");
+            }
+        }
+
+        void end_fixed_array(size_t size)
+        {
+            if (!is(']'))
+                self().set_error(fixed_array_error(size));
+            self().end_value();
+        }
+
+        static std::string fixed_array_error(size_t size)
+        {
+            return "expected " + std::to_string(size) + " array items";
+        }
+
+        reader_limits limits;
+        size_t depth = 0;
+
+    private:
+        READER& self() { return static_cast<READER&>(*this); }
+    };
+}
+
+#endif  // REACTIVE_JSON_READER_CORE_H
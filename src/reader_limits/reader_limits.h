@@ -0,0 +1,47 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_READER_LIMITS_H
+#define REACTIVE_JSON_READER_LIMITS_H
+
+#include <cstddef>
+
+namespace reactive_json
+{
+    /// Resource limits protecting readers from hostile input.
+    /// Exceeding any limit switches the reader to the error state with a specific error message.
+    /// All limits are disabled by default.
+    struct reader_limits
+    {
+        static constexpr size_t unlimited = ~size_t(0);
+
+        /// Maximum nesting of arrays and objects, both parsed and skipped.
+        /// Error: "max depth exceeded".
+        size_t max_depth = unlimited;
+
+        /// Maximum size in bytes of a single extracted string (including field names).
+        /// Unlike the `max_size` parameter of `try_string`, that silently truncates the string, this one fails.
+        /// Error: "string too long".
+        size_t max_string_size = unlimited;
+
+        /// Maximum total size in bytes of all strings extracted in the parsing session.
+        /// Error: "allocation limit exceeded".
+        size_t max_allocated = unlimited;
+
+        /// Maximum size in bytes of the parsed document.
+        /// Error: "document too large".
+        size_t max_document_size = unlimited;
+    };
+}
+
+#endif  // REACTIVE_JSON_READER_LIMITS_H
@@ -0,0 +1,377 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_SERIALIZATION_H
+#define REACTIVE_JSON_SERIALIZATION_H
+
+#include <array>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "../reader_core/reader_core.h"
+#include "../writer/writer.h"
+
+namespace reactive_json
+{
+    /// Maps the type `T` to JSON.
+    /// Specializations provide:
+    /// - `template<typename READER> static bool try_read(READER& json, T& value)`,
+    ///   that reads the `value` if the current element has the matching JSON type and returns true,
+    ///   otherwise returns false leaving the position and the `value` intact,
+    /// - `static void write(writer& out, const T& value)`.
+    /// This library specializes it for arithmetic types, `bool`, `std::string`, `std::vector`, `std::array`,
+    /// `std::pair`, `std::tuple`, `std::map`/`std::unordered_map` with string keys, `std::optional`, `std::unique_ptr`
+    /// and `std::variant`.
+    /// Applications specialize it for their own structs.
+    /// Numbers are written as `double`, so integers above 2^53 lose precision.
+    /// Numbers that don't fit their arithmetic types switch the reader to the error state (see `convert_number`).
+    template<typename T, typename ENABLE = void>
+    struct json_traits
+    {
+        static_assert(sizeof(T) == 0, "no json_traits specialization for this type");
+    };
+
+    /// Reads the current element to the `value` with any reader (`memory_block_reader`, `istream_reader`).
+    /// If the element has a mismatched JSON type, skips it and leaves the `value` intact.
+    /// Example:
+    /// std::map<std::string, std::vector<std::optional<double>>> series;
+    /// reactive_json::read(json, series);
+    template<typename READER, typename T>
+    void read(READER& json, T& value)
+    {
+        if (!json_traits<T>::try_read(json, value))
+            json.skip();
+    }
+
+    /// Reads the current element to the `value` if it has the matching JSON type, see `json_traits::try_read`.
+    template<typename READER, typename T>
+    bool try_read(READER& json, T& value)
+    {
+        return json_traits<T>::try_read(json, value);
+    }
+
+    /// Writes the `value` with the `writer`.
+    /// Example:
+    /// reactive_json::writer out(std::cout);
+    /// reactive_json::write(out, series);
+    template<typename T>
+    void write(writer& out, const T& value)
+    {
+        json_traits<T>::write(out, value);
+    }
+
+    namespace detail
+    {
+        template<typename READER, typename = void>
+        struct has_is_indexed : std::false_type {};
+
+        template<typename READER>
+        struct has_is_indexed<READER, std::void_t<decltype(std::declval<READER&>().is_indexed())>>
+            : std::true_type {};
+
+        // Reads array items one by one, the array size must match the number of items.
+        template<typename READER, typename ON_ITEM>
+        bool try_read_fixed(READER& json, size_t size, ON_ITEM on_item)
+        {
+            size_t index = 0;
+            if (!json.try_array([&] {
+                    if (index < size)
+                        on_item(index++);
+                    else
+                        json.set_error("expected " + std::to_string(size) + " array items");
+                }))
+                return false;
+            if (index != size)
+                json.set_error("expected " + std::to_string(size) + " array items");
+            return true;
+        }
+
+        // Items are expanded at compile time, so their code is inlined: writes are unrolled like
+        // `reader_core::read_fixed_items`, reads go through a chain of index comparisons.
+        template<typename TUPLE, typename INDEXES = std::make_index_sequence<std::tuple_size_v<TUPLE>>>
+        struct tuple_traits;
+
+        template<typename TUPLE, size_t... I>
+        struct tuple_traits<TUPLE, std::index_sequence<I...>>
+        {
+            template<typename READER>
+            static bool try_read(READER& json, TUPLE& value)
+            {
+                return try_read_fixed(json, sizeof...(I), [&](size_t index) {
+                    // Stops at the matching item, `index` grows by one on each call.
+                    ((index == I && (read(json, std::get<I>(value)), true)) || ...);
+                });
+            }
+
+            static void write(writer& out, const TUPLE& value)
+            {
+                out.write_raw("[");
+                ((out.write_raw(I == 0 ? "" : ","), reactive_json::write(out, std::get<I>(value))), ...);
+                out.write_raw("]");
+            }
+        };
+
+        template<typename MAP>
+        struct map_traits
+        {
+            template<typename READER>
+            static bool try_read(READER& json, MAP& value)
+            {
+                bool is_cleared = false;
+                if (!json.try_object([&](std::string name) {
+                        if (!is_cleared) {
+                            value.clear();
+                            is_cleared = true;
+                        }
+                        read(json, value[std::move(name)]);
+                    }))
+                    return false;
+                if (!is_cleared)
+                    value.clear();
+                return true;
+            }
+
+            static void write(writer& out, const MAP& value)
+            {
+                out.write_object([&](auto fields) {
+                    for (auto& field : value)
+                        reactive_json::write(fields.write_field(field.first.c_str()), field.second);
+                });
+            }
+        };
+    }
+
+    template<typename T>
+    struct json_traits<T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>>
+    {
+        template<typename READER>
+        static bool try_read(READER& json, T& value)
+        {
+            auto r = json.try_number();
+            if (!r)
+                return false;
+            if (auto error = convert_number(*r, value))
+                json.set_error(error);
+            return true;
+        }
+
+        static void write(writer& out, T value) { out(double(value)); }
+    };
+
+    template<>
+    struct json_traits<bool>
+    {
+        template<typename READER>
+        static bool try_read(READER& json, bool& value)
+        {
+            auto r = json.try_bool();
+            if (r)
+                value = *r;
+            return r.has_value();
+        }
+
+        static void write(writer& out, bool value) { out(value); }
+    };
+
+    template<>
+    struct json_traits<std::string>
+    {
+        /// Reuses the `value` buffer.
+        template<typename READER>
+        static bool try_read(READER& json, std::string& value) { return json.try_string(value); }
+
+        static void write(writer& out, const std::string& value) { out(std::string_view(value)); }
+    };
+
+    template<typename T, typename ALLOCATOR>
+    struct json_traits<std::vector<T, ALLOCATOR>>
+    {
+        /// With an indexed `memory_block_reader` the vector is reserved once for the counted number of items.
+        template<typename READER>
+        static bool try_read(READER& json, std::vector<T, ALLOCATOR>& value)
+        {
+            auto on_item = [&] {
+                if constexpr (std::is_same_v<T, bool>) {
+                    bool item = false;
+                    read(json, item);
+                    value.push_back(item);
+                } else {
+                    value.emplace_back();
+                    read(json, value.back());
+                }
+            };
+            if constexpr (detail::has_is_indexed<READER>::value) {
+                // Without an index counting is one more pass over the array, and it repeats for each nesting level.
+                if (json.is_indexed()) {
+                    return json.try_array_sized(
+                        [&](size_t size) {
+                            value.clear();
+                            value.reserve(size);
+                        },
+                        on_item);
+                }
+            }
+            bool is_cleared = false;
+            if (!json.try_array([&] {
+                    if (!is_cleared) {
+                        value.clear();
+                        is_cleared = true;
+                    }
+                    on_item();
+                }))
+                return false;
+            if (!is_cleared)
+                value.clear();
+            return true;
+        }
+
+        static void write(writer& out, const std::vector<T, ALLOCATOR>& value)
+        {
+            out.write_array(value.size(), [&](auto& out, size_t index) { reactive_json::write(out, value[index]); });
+        }
+    };
+
+    template<typename T, size_t N>
+    struct json_traits<std::array<T, N>>
+    {
+        template<typename READER>
+        static bool try_read(READER& json, std::array<T, N>& value)
+        {
+            return detail::try_read_fixed(json, N, [&](size_t index) { read(json, value[index]); });
+        }
+
+        static void write(writer& out, const std::array<T, N>& value)
+        {
+            out.write_array(N, [&](auto& out, size_t index) { reactive_json::write(out, value[index]); });
+        }
+    };
+
+    template<typename A, typename B>
+    struct json_traits<std::pair<A, B>> : detail::tuple_traits<std::pair<A, B>> {};
+
+    template<typename... T>
+    struct json_traits<std::tuple<T...>> : detail::tuple_traits<std::tuple<T...>> {};
+
+    template<typename T, typename... REST>
+    struct json_traits<std::map<std::string, T, REST...>> : detail::map_traits<std::map<std::string, T, REST...>> {};
+
+    template<typename T, typename... REST>
+    struct json_traits<std::unordered_map<std::string, T, REST...>> : detail::map_traits<std::unordered_map<std::string, T, REST...>> {};
+
+    template<typename T>
+    struct json_traits<std::optional<T>>
+    {
+        /// `null` resets the `value`.
+        template<typename READER>
+        static bool try_read(READER& json, std::optional<T>& value)
+        {
+            if (json.get_null()) {
+                value.reset();
+                return true;
+            }
+            T item{};
+            if (!json_traits<T>::try_read(json, value ? *value : item))
+                return false;
+            if (!value)
+                value = std::move(item);
+            return true;
+        }
+
+        static void write(writer& out, const std::optional<T>& value)
+        {
+            if (value)
+                reactive_json::write(out, *value);
+            else
+                out(nullptr);
+        }
+    };
+
+    template<typename T>
+    struct json_traits<std::unique_ptr<T>>
+    {
+        /// `null` resets the `value`, other elements are read to the pointed object, that is allocated if needed.
+        /// It allows recursive structs, like tree nodes holding their children.
+        template<typename READER>
+        static bool try_read(READER& json, std::unique_ptr<T>& value)
+        {
+            if (json.get_null()) {
+                value.reset();
+                return true;
+            }
+            auto item = value ? nullptr : std::make_unique<T>();
+            if (!json_traits<T>::try_read(json, value ? *value : *item))
+                return false;
+            if (!value)
+                value = std::move(item);
+            return true;
+        }
+
+        static void write(writer& out, const std::unique_ptr<T>& value)
+        {
+            if (value)
+                reactive_json::write(out, *value);
+            else
+                out(nullptr);
+        }
+    };
+
+    template<>
+    struct json_traits<std::monostate>
+    {
+        template<typename READER>
+        static bool try_read(READER& json, std::monostate&) { return json.get_null(); }
+
+        static void write(writer& out, std::monostate) { out(nullptr); }
+    };
+
+    template<typename... T>
+    struct json_traits<std::variant<T...>>
+    {
+        /// Takes the first alternative that accepts the JSON type of the current element,
+        /// for example `std::variant<double, std::string>` reads numbers to `double` and strings to `std::string`.
+        /// Alternatives of the same JSON type (like two containers read from arrays) are not distinguished by their content.
+        template<typename READER>
+        static bool try_read(READER& json, std::variant<T...>& value)
+        {
+            return (try_alternative<T>(json, value) || ...);
+        }
+
+        static void write(writer& out, const std::variant<T...>& value)
+        {
+            std::visit([&](auto& item) { reactive_json::write(out, item); }, value);
+        }
+
+    private:
+        template<typename ALTERNATIVE, typename READER>
+        static bool try_alternative(READER& json, std::variant<T...>& value)
+        {
+            if (auto current = std::get_if<ALTERNATIVE>(&value))
+                return json_traits<ALTERNATIVE>::try_read(json, *current);
+            ALTERNATIVE item{};
+            if (!json_traits<ALTERNATIVE>::try_read(json, item))
+                return false;
+            value = std::move(item);
+            return true;
+        }
+    };
+}
+
+#endif  // REACTIVE_JSON_SERIALIZATION_H
@@ -0,0 +1,147 @@
+#include <sstream>
+#include <memory>
+#include "serialization.h"
+#include "../memory_block_reader/memory_block_reader.h"
+#include "../memory_block_reader/structural_index.h"
+#include "../istream_reader/istream_reader.h"
+#include "gunit.h"
+
+namespace
+{
+    struct point
+    {
+        int x = 0, y = 0;
+
+        bool operator== (const point& other) const { return x == other.x && y == other.y; }
+    };
+
+    using document = std::tuple<
+        std::map<std::string, std::variant<std::vector<std::optional<double>>, std::string, point>>,
+        std::pair<std::string, std::array<point, 2>>,
+        bool>;
+
+    const char* text =
+        R"-([{"origin":{"x":1,"y":2},"series":[1,null,3.5],"title":"t\"1"},)-"
+        R"-(["line",[{"x":1,"y":2},{"x":3,"y":4}]],true])-";
+}
+
+namespace reactive_json
+{
+    template<>
+    struct json_traits<point>
+    {
+        template<typename READER>
+        static bool try_read(READER& json, point& value)
+        {
+            return json.try_object([&](auto name) {
+                if (name == "x") read(json, value.x);
+                else if (name == "y") read(json, value.y);
+            });
+        }
+
+        static void write(writer& out, const point& value)
+        {
+            out.write_object([&](auto fields) {
+                fields("x", double(value.x))("y", double(value.y));
+            });
+        }
+    };
+}
+
+namespace
+{
+    TEST(Serialization, RoundTrip)
+    {
+        document doc;
+        reactive_json::memory_block_reader json(text);
+        reactive_json::read(json, doc);
+        ASSERT_TRUE(json.success());
+        auto& fields = std::get<0>(doc);
+        ASSERT_EQ(fields.size(), 3);
+        auto& series = std::get<0>(fields["series"]);
+        ASSERT_EQ(series.size(), 3);
+        ASSERT_FALSE(series[1].has_value());
+        ASSERT_EQ(*series[2], 3.5);
+        ASSERT_EQ(std::get<1>(fields["title"]), "t\"1");
+        ASSERT_EQ(std::get<2>(fields["origin"]).y, 2);
+        ASSERT_EQ(std::get<1>(doc).second[1].y, 4);
+        ASSERT_TRUE(std::get<2>(doc));
+
+        std::ostringstream out;
+        reactive_json::writer w(out);
+        reactive_json::write(w, doc);
+        ASSERT_EQ(out.str(), text);
+
+        document stream_doc;
+        reactive_json::istream_reader stream_json(std::make_unique<std::stringstream>(text));
+        reactive_json::read(stream_json, stream_doc);
+        ASSERT_TRUE(stream_json.success());
+        ASSERT_TRUE(stream_doc == doc);
+    }
+
+    TEST(Serialization, Mismatches)
+    {
+        std::vector<int> items{ 1, 2 };
+        reactive_json::memory_block_reader json("[\"a\", {}, 3]");
+        reactive_json::read(json, items);
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(items.size(), 3);
+        ASSERT_EQ(items[0], 0);
+        ASSERT_EQ(items[2], 3);
+
+        json.reset("{\"a\": 1}");
+        reactive_json::read(json, items);
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(items.size(), 3);
+
+        json.reset("[]");
+        reactive_json::read(json, items);
+        ASSERT_TRUE(items.empty());
+
+        std::array<int, 2> pair{};
+        json.reset("[1, 2, 3]");
+        reactive_json::read(json, pair);
+        ASSERT_EQ(json.get_error_message(), "expected 2 array items");
+    }
+
+    TEST(Serialization, NumberRanges)
+    {
+        auto error = [](const char* text, auto value) {
+            reactive_json::memory_block_reader json(text);
+            reactive_json::read(json, value);
+            return json.get_error_message();
+        };
+        ASSERT_EQ(error("-128", int8_t()), "");
+        ASSERT_EQ(error("128", int8_t()), "integer out of range");
+        ASSERT_EQ(error("-1", uint32_t()), "integer out of range");
+        ASSERT_EQ(error("1e30", int64_t()), "integer out of range");
+        ASSERT_EQ(error("1.5", int()), "expected integer");
+        ASSERT_EQ(error("1e300", float()), "number out of range");
+        ASSERT_EQ(error("1.5", double()), "");
+
+        std::tuple<int, std::string> item{ 7, "" };
+        reactive_json::memory_block_reader json("[1.5, \"a\"]");
+        reactive_json::read(json, item);
+        ASSERT_EQ(json.get_error_message(), "expected integer");
+        ASSERT_EQ(std::get<0>(item), 7);
+    }
+
+    TEST(Serialization, IndexedVectors)
+    {
+        const char* text = "[[1, 2], [], [3, [4, 5]]]";
+        reactive_json::structural_index index;
+        ASSERT_TRUE(index.build(text, strlen(text)));
+        std::vector<std::variant<double, std::vector<std::variant<double, std::vector<double>>>>> indexed, scanned;
+        reactive_json::memory_block_reader json(text);
+        json.set_index(&index);
+        ASSERT_TRUE(json.is_indexed());
+        reactive_json::read(json, indexed);
+        ASSERT_TRUE(json.success());
+        json.reset(text);
+        ASSERT_FALSE(json.is_indexed());
+        reactive_json::read(json, scanned);
+        ASSERT_TRUE(json.success());
+        ASSERT_TRUE(indexed == scanned);
+        ASSERT_EQ(indexed.size(), 3);
+    }
+}
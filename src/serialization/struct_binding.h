@@ -0,0 +1,219 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_STRUCT_BINDING_H
+#define REACTIVE_JSON_STRUCT_BINDING_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "serialization.h"
+#include "../memory_block_reader/object_shape.h"
+
+/// Binds struct fields to JSON object fields with the same names.
+/// It specializes `reactive_json::json_traits` for the struct, so it can be passed to `reactive_json::read/write`
+/// and used as a field or item of other bound types and standard containers.
+/// Must be placed in the namespace of the struct after its definition. Up to 32 fields are supported.
+/// - Field types can be any types supported by `reactive_json::json_traits`.
+/// - `std::optional` and `std::unique_ptr` fields are optional: absent fields become empty, empty fields are not written.
+/// - Other fields are required: if any of them is absent, the reader switches to the error state "missing field NAME".
+/// - Unknown fields are skipped.
+/// Example:
+/// struct point { double x, y; std::optional<std::string> label; };
+/// REACTIVE_JSON_FIELDS(point, x, y, label)
+/// ...
+/// std::vector<point> points;
+/// reactive_json::read(json, points);
+#define REACTIVE_JSON_FIELDS(TYPE, ...) \
+    [[maybe_unused]] constexpr auto reactive_json_fields(const TYPE*) \
+    { \
+        return std::make_tuple(REACTIVE_JSON_FOR_EACH(REACTIVE_JSON_FIELD_BINDING, TYPE, __VA_ARGS__)); \
+    }
+
+#define REACTIVE_JSON_FIELD_BINDING(TYPE, FIELD) \
+    reactive_json::field_binding<TYPE, decltype(TYPE::FIELD)>{ #FIELD, ",\"" #FIELD "\":", &TYPE::FIELD }
+
+#define REACTIVE_JSON_EXPAND(X) X
+#define REACTIVE_JSON_FOR_EACH_1(M, T, F) M(T, F)
+#define REACTIVE_JSON_FOR_EACH_2(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_1(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_3(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_2(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_4(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_3(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_5(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_4(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_6(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_5(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_7(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_6(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_8(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_7(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_9(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_8(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_10(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_9(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_11(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_10(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_12(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_11(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_13(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_12(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_14(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_13(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_15(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_14(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_16(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_15(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_17(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_16(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_18(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_17(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_19(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_18(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_20(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_19(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_21(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_20(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_22(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_21(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_23(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_22(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_24(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_23(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_25(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_24(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_26(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_25(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_27(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_26(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_28(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_27(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_29(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_28(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_30(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_29(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_31(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_30(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_32(M, T, F, ...) M(T, F), REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_31(M, T, __VA_ARGS__))
+#define REACTIVE_JSON_FOR_EACH_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, NAME, ...) NAME
+#define REACTIVE_JSON_FOR_EACH(M, T, ...) \
+    REACTIVE_JSON_EXPAND(REACTIVE_JSON_EXPAND(REACTIVE_JSON_FOR_EACH_PICK(__VA_ARGS__, \
+        REACTIVE_JSON_FOR_EACH_32, REACTIVE_JSON_FOR_EACH_31, REACTIVE_JSON_FOR_EACH_30, REACTIVE_JSON_FOR_EACH_29, REACTIVE_JSON_FOR_EACH_28, REACTIVE_JSON_FOR_EACH_27, REACTIVE_JSON_FOR_EACH_26, REACTIVE_JSON_FOR_EACH_25, REACTIVE_JSON_FOR_EACH_24, REACTIVE_JSON_FOR_EACH_23, REACTIVE_JSON_FOR_EACH_22, REACTIVE_JSON_FOR_EACH_21, REACTIVE_JSON_FOR_EACH_20, REACTIVE_JSON_FOR_EACH_19, REACTIVE_JSON_FOR_EACH_18, REACTIVE_JSON_FOR_EACH_17, REACTIVE_JSON_FOR_EACH_16, REACTIVE_JSON_FOR_EACH_15, REACTIVE_JSON_FOR_EACH_14, REACTIVE_JSON_FOR_EACH_13, REACTIVE_JSON_FOR_EACH_12, REACTIVE_JSON_FOR_EACH_11, REACTIVE_JSON_FOR_EACH_10, REACTIVE_JSON_FOR_EACH_9, REACTIVE_JSON_FOR_EACH_8, REACTIVE_JSON_FOR_EACH_7, REACTIVE_JSON_FOR_EACH_6, REACTIVE_JSON_FOR_EACH_5, REACTIVE_JSON_FOR_EACH_4, REACTIVE_JSON_FOR_EACH_3, REACTIVE_JSON_FOR_EACH_2, REACTIVE_JSON_FOR_EACH_1))(M, T, __VA_ARGS__))
+
+namespace reactive_json
+{
+    /// Description of one struct field made by `REACTIVE_JSON_FIELDS`.
+    template<typename T, typename MEMBER>
+    struct field_binding
+    {
+        std::string_view name;
+        const char* prefix;  // `,"name":`, written as is, so names must not need escaping
+        MEMBER T::* member;
+    };
+
+    namespace detail
+    {
+        template<typename T>
+        struct is_optional : std::false_type {};
+
+        template<typename T>
+        struct is_optional<std::optional<T>> : std::true_type {};
+
+        template<typename T>
+        struct is_optional<std::unique_ptr<T>> : std::true_type {};
+
+        struct ignore_key
+        {
+            void operator()(size_t) {}
+        };
+
+        template<typename READER, typename = void>
+        struct has_object_shape : std::false_type {};
+
+        template<typename READER>
+        struct has_object_shape<READER, std::void_t<decltype(
+            std::declval<READER&>().try_object(std::declval<object_shape&>(), ignore_key()))>>
+            : std::true_type {};
+    }
+
+    template<typename T>
+    struct json_traits<T, std::void_t<decltype(reactive_json_fields(std::declval<const T*>()))>>
+    {
+        static constexpr auto fields = reactive_json_fields(static_cast<const T*>(nullptr));
+        static constexpr size_t field_count = std::tuple_size_v<decltype(fields)>;
+        static_assert(field_count <= 64, "too many fields");
+
+        /// With `memory_block_reader` field names are matched in place with the learned field order, see `object_shape`.
+        template<typename READER>
+        static bool try_read(READER& json, T& value)
+        {
+            uint64_t present = 0;
+            auto on_key = [&](size_t key) {
+                if (key < field_count) {
+                    present |= uint64_t(1) << key;
+                    read_field(json, value, key);
+                }
+            };
+            bool is_object;
+            if constexpr (detail::has_object_shape<READER>::value) {
+                static thread_local object_shape shape = std::apply(
+                    [](auto&... field) { return object_shape{ field.name... }; }, fields);
+                is_object = json.try_object(shape, on_key);
+            } else {
+                is_object = json.try_object([&](const std::string& name) { on_key(find_key(name)); });
+            }
+            if (!is_object)
+                return false;
+            size_t key = 0;
+            std::apply([&](auto&... field) { (check_absent(json, value, field, present & (uint64_t(1) << key++)), ...); }, fields);
+            return true;
+        }
+
+        /// Writes field names with surrounding punctuation as precomposed literals.
+        static void write(writer& out, const T& value)
+        {
+            bool is_first = true;
+            std::apply([&](auto&... field) { (write_field(out, value, field, is_first), ...); }, fields);
+            out.write_raw(is_first ? "{}" : "}");
+        }
+
+    private:
+        static size_t find_key(std::string_view name)
+        {
+            size_t key = 0, r = field_count;
+            std::apply([&](auto&... field) { ((r == field_count && field.name == name ? void(r = key) : void(), key++), ...); }, fields);
+            return r;
+        }
+
+        template<typename READER>
+        static void read_field(READER& json, T& value, size_t key)
+        {
+            read_field(json, value, key, std::make_index_sequence<field_count>());
+        }
+
+        // The member reads are inlined into one chain of key comparisons, that stops at the matching key.
+        template<typename READER, size_t... I>
+        static void read_field(READER& json, T& value, size_t key, std::index_sequence<I...>)
+        {
+            ((key == I && (read(json, value.*std::get<I>(fields).member), true)) || ...);
+        }
+
+        template<typename READER, typename MEMBER>
+        static void check_absent(READER& json, T& value, const field_binding<T, MEMBER>& field, bool is_present)
+        {
+            if (is_present)
+                return;
+            if constexpr (detail::is_optional<MEMBER>::value)
+                (value.*field.member).reset();
+            else
+                json.set_error("missing field " + std::string(field.name));
+        }
+
+        template<typename MEMBER>
+        static void write_field(writer& out, const T& value, const field_binding<T, MEMBER>& field, bool& is_first)
+        {
+            auto& member = value.*field.member;
+            if constexpr (detail::is_optional<MEMBER>::value) {
+                if (!member)
+                    return;
+            }
+            if (is_first) {
+                out.write_raw("{");
+                out.write_raw(field.prefix + 1);
+                is_first = false;
+            } else {
+                out.write_raw(field.prefix);
+            }
+            reactive_json::write(out, member);
+        }
+    };
+}
+
+#endif  // REACTIVE_JSON_STRUCT_BINDING_H
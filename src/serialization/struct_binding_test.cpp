@@ -0,0 +1,70 @@
+#include <sstream>
+#include <memory>
+#include "struct_binding.h"
+#include "../memory_block_reader/memory_block_reader.h"
+#include "../istream_reader/istream_reader.h"
+#include "gunit.h"
+
+namespace
+{
+    struct point
+    {
+        double x = 0, y = 0;
+    };
+    REACTIVE_JSON_FIELDS(point, x, y)
+
+    struct polygon
+    {
+        std::string name;
+        std::optional<bool> is_active;
+        std::vector<point> points;
+    };
+    REACTIVE_JSON_FIELDS(polygon, name, is_active, points)
+
+    const char* text =
+        R"-([{"name":"p1","is_active":false,"points":[{"x":11,"y":32},{"x":12,"y":23}]},)-"
+        R"-({"name":"Corner","points":[]}])-";
+
+    TEST(StructBinding, RoundTrip)
+    {
+        std::vector<polygon> polygons;
+        reactive_json::memory_block_reader json(text);
+        reactive_json::read(json, polygons);
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(polygons.size(), 2);
+        ASSERT_EQ(polygons[0].points[1].y, 23);
+        ASSERT_TRUE(polygons[0].is_active.has_value());
+        ASSERT_FALSE(polygons[1].is_active.has_value());
+
+        std::ostringstream out;
+        reactive_json::writer w(out);
+        reactive_json::write(w, polygons);
+        ASSERT_EQ(out.str(), text);
+
+        std::vector<polygon> stream_polygons;
+        reactive_json::istream_reader stream_json(std::make_unique<std::stringstream>(text));
+        reactive_json::read(stream_json, stream_polygons);
+        ASSERT_TRUE(stream_json.success());
+        ASSERT_EQ(stream_polygons[0].name, "p1");
+        ASSERT_EQ(stream_polygons[0].points[0].x, 11);
+    }
+
+    TEST(StructBinding, FieldOrderAndMissingFields)
+    {
+        std::vector<point> points;
+        reactive_json::memory_block_reader json(R"-([{"y": 2, "x": 1, "z": [3]}, {"x": 4, "y": 5}])-");
+        reactive_json::read(json, points);
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(points[0].x, 1);
+        ASSERT_EQ(points[1].y, 5);
+
+        json.reset(R"-([{"x": 1}])-");
+        reactive_json::read(json, points);
+        ASSERT_EQ(json.get_error_message(), "missing field y");
+
+        reactive_json::istream_reader stream_json(std::make_unique<std::stringstream>(R"-({"points": [], "is_active": true})-"));
+        polygon poly;
+        reactive_json::read(stream_json, poly);
+        ASSERT_EQ(stream_json.get_error_message(), "missing field name");
+    }
+}
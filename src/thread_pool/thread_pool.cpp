@@ -0,0 +1,62 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "thread_pool.h"
+
+namespace reactive_json
+{
+    thread_pool::thread_pool(size_t threads)
+    {
+        if (!threads)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; i++)
+            workers.emplace_back([this] { work(); });
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        has_tasks.notify_all();
+        for (auto& w : workers)
+            w.join();
+    }
+
+    void thread_pool::post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        has_tasks.notify_one();
+    }
+
+    void thread_pool::work()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                has_tasks.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+}
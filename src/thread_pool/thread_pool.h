@@ -0,0 +1,76 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_THREAD_POOL_H
+#define REACTIVE_JSON_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reactive_json
+{
+    /// Fixed set of worker threads executing submitted tasks in FIFO order.
+    /// Used by the parallel reading and writing helpers of this library.
+    /// Can be shared by any number of parallel operations.
+    class thread_pool
+    {
+    public:
+        /// Starts `threads` workers, if zero - one per hardware thread.
+        explicit thread_pool(size_t threads = 0);
+
+        /// Finishes all queued tasks and joins workers.
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator= (const thread_pool&) = delete;
+
+        /// Returns the number of worker threads.
+        size_t size() const { return workers.size(); }
+
+        /// Queues the `task` for execution.
+        /// Returns the future that receives the task result or its exception.
+        /// Example:
+        /// thread_pool pool;
+        /// auto sum = pool.submit([]{ return 2 + 2; });
+        /// assert(sum.get() == 4);
+        template<typename TASK>
+        auto submit(TASK&& task) -> std::future<decltype(task())>
+        {
+            auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::forward<TASK>(task));
+            auto result = packaged->get_future();
+            post([packaged] { (*packaged)(); });
+            return result;
+        }
+
+        /// Queues the `task` for execution without tracking its completion.
+        /// The task must not throw.
+        void post(std::function<void()> task);
+
+    private:
+        void work();
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable has_tasks;
+        bool stopping = false;
+    };
+}
+
+#endif  // REACTIVE_JSON_THREAD_POOL_H
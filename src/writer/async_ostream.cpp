@@ -0,0 +1,134 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "async_ostream.h"
+
+namespace reactive_json
+{
+    async_streambuf::async_streambuf(std::unique_ptr<std::ostream> sink, async_options options)
+        : holder(std::move(sink))
+        , sink(*holder)
+    {
+        start(options);
+    }
+
+    async_streambuf::async_streambuf(std::ostream& sink, async_options options)
+        : sink(sink)
+    {
+        start(options);
+    }
+
+    void async_streambuf::start(async_options options)
+    {
+        if (options.buffer_count < 2)
+            options.buffer_count = 2;
+        if (!options.buffer_size)
+            options.buffer_size = 1;
+        buffers.resize(options.buffer_count);
+        for (size_t i = 0; i < buffers.size(); i++) {
+            buffers[i].resize(options.buffer_size);
+            free_buffers.push_back(i);
+        }
+        current = free_buffers.front();
+        free_buffers.pop_front();
+        setp(buffers[current].data(), buffers[current].data() + buffers[current].size());
+        flusher = std::thread([this] { flush_loop(); });
+    }
+
+    async_streambuf::~async_streambuf()
+    {
+        sync();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        has_filled.notify_one();
+        flusher.join();
+    }
+
+    bool async_streambuf::pass_current()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pptr() != pbase()) {
+            filled_buffers.push_back({ current, size_t(pptr() - pbase()) });
+            in_progress++;
+            has_filled.notify_one();
+            has_free.wait(lock, [&] { return !free_buffers.empty(); });
+            current = free_buffers.front();
+            free_buffers.pop_front();
+            setp(buffers[current].data(), buffers[current].data() + buffers[current].size());
+        }
+        return !failed;
+    }
+
+    async_streambuf::int_type async_streambuf::overflow(int_type c)
+    {
+        if (!pass_current())
+            return traits_type::eof();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize async_streambuf::xsputn(const char* s, std::streamsize n)
+    {
+        for (auto left = n; left;) {
+            if (pptr() == epptr() && !pass_current())
+                return n - left;
+            auto chunk = std::min<std::streamsize>(left, epptr() - pptr());
+            std::memcpy(pptr(), s, size_t(chunk));
+            pbump(int(chunk));
+            s += chunk;
+            left -= chunk;
+        }
+        return n;
+    }
+
+    int async_streambuf::sync()
+    {
+        pass_current();
+        std::unique_lock<std::mutex> lock(mutex);
+        has_free.wait(lock, [&] { return in_progress == 0; });
+        return failed ? -1 : 0;
+    }
+
+    void async_streambuf::flush_loop()
+    {
+        for (;;) {
+            filled_buffer next;
+            bool is_last;  // flush the sink only when there is nothing more to write
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                has_filled.wait(lock, [&] { return stopping || !filled_buffers.empty(); });
+                if (filled_buffers.empty())
+                    return;
+                next = filled_buffers.front();
+                filled_buffers.pop_front();
+                is_last = filled_buffers.empty();
+            }
+            sink.write(buffers[next.index].data(), next.size);
+            if (is_last)
+                sink.flush();
+            std::lock_guard<std::mutex> lock(mutex);
+            failed |= !sink.good();
+            free_buffers.push_back(next.index);
+            in_progress--;
+            has_free.notify_all();
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_ASYNC_OSTREAM_H
+#define REACTIVE_JSON_ASYNC_OSTREAM_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace reactive_json
+{
+    /// Parameters of background flushing.
+    struct async_options
+    {
+        /// Size of each buffer passed to one `write` of the sink stream.
+        size_t buffer_size = 1 << 16;
+
+        /// Number of buffers, at least 2. It limits the amount of memory holding not yet written data.
+        size_t buffer_count = 2;
+    };
+
+    /// Stream buffer that writes to the sink stream on a background thread.
+    /// The serializing thread fills one buffer while the flusher thread writes the others.
+    /// When all buffers are waiting for the flusher, the serializing thread blocks until one of them is written.
+    /// `pubsync` (and so `std::ostream::flush`) waits until all data is written and the sink is flushed.
+    class async_streambuf : public std::streambuf
+    {
+    public:
+        /// Constructs buffer that owns the sink stream.
+        async_streambuf(std::unique_ptr<std::ostream> sink, async_options options = {});
+
+        /// Constructs buffer that borrows the sink stream.
+        async_streambuf(std::ostream& sink, async_options options = {});
+
+        /// Writes all buffered data and stops the flusher thread.
+        ~async_streambuf();
+
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char* s, std::streamsize n) override;
+        int sync() override;
+
+    private:
+        struct filled_buffer {
+            size_t index;
+            size_t size;
+        };
+
+        void start(async_options options);
+        bool pass_current();  // hands the current buffer to the flusher and takes a free one
+        void flush_loop();
+
+        std::unique_ptr<std::ostream> holder;
+        std::ostream& sink;
+        std::vector<std::vector<char>> buffers;
+        std::deque<size_t> free_buffers;
+        std::deque<filled_buffer> filled_buffers;
+        size_t current;
+        size_t in_progress = 0;  // filled buffers not yet returned by the flusher
+        bool failed = false;
+        bool stopping = false;
+        std::mutex mutex;
+        std::condition_variable has_free;
+        std::condition_variable has_filled;
+        std::thread flusher;
+    };
+
+    /// `std::ostream` that writes to its sink on a background thread using `async_streambuf`.
+    class async_ostream : public std::ostream
+    {
+    public:
+        /// Constructs stream that owns the sink stream.
+        async_ostream(std::unique_ptr<std::ostream> sink, async_options options = {})
+            : std::ostream(nullptr)
+            , buffer(std::move(sink), options)
+        {
+            rdbuf(&buffer);
+        }
+
+        /// Constructs stream that borrows the sink stream.
+        async_ostream(std::ostream& sink, async_options options = {})
+            : std::ostream(nullptr)
+            , buffer(sink, options)
+        {
+            rdbuf(&buffer);
+        }
+
+    private:
+        async_streambuf buffer;
+    };
+}
+
+#endif  // REACTIVE_JSON_ASYNC_OSTREAM_H
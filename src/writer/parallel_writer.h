@@ -0,0 +1,89 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef REACTIVE_JSON_PARALLEL_WRITER_H
+#define REACTIVE_JSON_PARALLEL_WRITER_H
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <sstream>
+#include <string>
+
+#include "writer.h"
+#include "../thread_pool/thread_pool.h"
+
+namespace reactive_json
+{
+    /// Outputs an array of items to the `out` writer serializing them in parallel on the `pool` threads.
+    /// The index range is split into chunks of `chunk_size` items (if zero, it is derived from the `size` and the pool size).
+    /// Each chunk is serialized by its own writer to its own buffer,
+    /// and buffers are appended to `out` in the index order, so the output is identical to `writer::write_array`.
+    /// `on_item` has the same signature as in `writer::write_array`, but it is called concurrently from different threads,
+    /// so it must be thread-safe. It receives the chunk writer, not `out`.
+    /// At most twice the pool size chunks are held in memory at any time.
+    /// Exceptions thrown by `on_item` are rethrown here.
+    /// Must not be called from a task running on the same `pool`.
+    /// Example:
+    /// thread_pool pool;
+    /// writer out(std::cout);
+    /// write_array_parallel(out, records.size(), [&](auto& writer, size_t index){
+    ///     write_record(writer, records[index]);
+    /// }, pool);
+    template<typename ON_ITEM>
+    void write_array_parallel(writer& out, size_t size, ON_ITEM&& on_item, thread_pool& pool, size_t chunk_size = 0)
+    {
+        if (!chunk_size)
+            chunk_size = std::max<size_t>(256, size / (pool.size() * 16));
+        size_t chunks = (size + chunk_size - 1) / chunk_size;
+        size_t max_in_flight = pool.size() * 2;
+        std::deque<std::future<std::string>> in_flight;
+        size_t next_chunk = 0;
+        auto submit_chunk = [&] {
+            size_t from = next_chunk++ * chunk_size;
+            size_t to = std::min(size, from + chunk_size);
+            in_flight.push_back(pool.submit([from, to, &out, &on_item] {
+                std::ostringstream buffer;
+                out.copy_format(buffer);
+                writer chunk_writer(buffer);
+                for (size_t i = from; i != to; i++) {
+                    if (i != from)
+                        buffer << ',';
+                    on_item(chunk_writer, i);
+                }
+                return buffer.str();
+            }));
+        };
+        out.write_raw("[");
+        while (next_chunk < chunks && in_flight.size() < max_in_flight)
+            submit_chunk();
+        try {
+            for (bool is_first = true; !in_flight.empty(); is_first = false) {
+                auto chunk = in_flight.front().get();
+                in_flight.pop_front();
+                if (next_chunk < chunks)
+                    submit_chunk();
+                if (!is_first)
+                    out.write_raw(",");
+                out.write_raw(chunk);
+            }
+        } catch (...) {
+            for (auto& f : in_flight)  // they reference `on_item`
+                f.wait();
+            throw;
+        }
+        out.write_raw("]");
+    }
+}
+
+#endif  // REACTIVE_JSON_PARALLEL_WRITER_H
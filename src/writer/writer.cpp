@@ -12,9 +12,22 @@ limitations under the License.
 */
 
 #include "writer.h"
+#include "async_ostream.h"
 
 namespace reactive_json
 {
+    namespace
+    {
+        // Makes the async stream that formats numbers like the `format` stream.
+        template<typename SINK>
+        std::unique_ptr<std::ostream> make_async(const std::ostream& format, SINK&& sink, async_options options)
+        {
+            auto r = std::make_unique<async_ostream>(std::forward<SINK>(sink), options);
+            r->flags(format.flags());
+            r->precision(format.precision());
+            return r;
+        }
+    }
 
     writer::writer(std::unique_ptr<std::ostream> sink)
         : holder(std::move(sink))
@@ -25,6 +38,22 @@ namespace reactive_json
         : sink(sink)
     {}
 
+    writer::writer(std::unique_ptr<std::ostream> sink, async_options async)
+        : holder(make_async(*sink, std::move(sink), async))
+        , sink(*holder)
+    {}
+
+    writer::writer(std::ostream& sink, async_options async)
+        : holder(make_async(sink, sink, async))
+        , sink(*holder)
+    {}
+
+    void writer::copy_format(std::ostream& stream) const
+    {
+        stream.flags(sink.flags());
+        stream.precision(sink.precision());
+    }
+
     void writer::operator() (double val)
     {
         sink << val;
@@ -20,6 +20,7 @@ limitations under the License.
 
 namespace reactive_json
 {
+    struct async_options;  // see async_ostream.h
 
     /// Outputs the JSON to the underlying std::ostream.
     class writer
@@ -32,6 +33,15 @@ namespace reactive_json
         /// Constructs writer that borrows the underlined stream.
         writer(std::ostream& sink);
 
+        /// Constructs writer that owns the underlined stream and writes to it on a background thread,
+        /// so formatting doesn't wait for the stream I/O. Numbers are formatted with the flags and precision of the stream.
+        /// All data is passed to the stream when this writer is destroyed.
+        /// Include "async_ostream.h" to use it.
+        writer(std::unique_ptr<std::ostream> sink, async_options async);
+
+        /// Constructs writer that borrows the underlined stream and writes to it on a background thread.
+        writer(std::ostream& sink, async_options async);
+
         /// Outputs single scalar numeric value.
         void operator() (double val);
 
@@ -47,6 +57,15 @@ namespace reactive_json
         /// Outputs single scalar string value. This one can contain \u0000 characters.
         void operator() (std::string_view val);
 
+        /// Outputs a preformatted piece of JSON as is.
+        /// Generated serializers use it to output field names together with punctuation in one call.
+        /// The caller is responsible for the validity of the resulting JSON.
+        void write_raw(std::string_view json) { sink.write(json.data(), json.size()); }
+
+        /// Applies the number formatting of this writer's stream to the `stream`,
+        /// so the parts of one document written to separate buffers look the same.
+        void copy_format(std::ostream& stream) const;
+
         /// Outputs an array of items.
         /// `size` defines the array size.
         /// `on_item` Is a lambda to be called for each array item.
@@ -1,6 +1,8 @@
 #include<vector>
 #include <sstream>
 #include "writer.h"
+#include "async_ostream.h"
+#include "parallel_writer.h"
 #include "gunit.h"
 
 namespace
@@ -52,4 +54,56 @@ namespace
         });
         ASSERT_EQ(s.str(), R"-([{"name":"First","active":true,"points":[{"x":0,"y":0},{"x":10,"y":-10.5},{"x":1e+11,"y":0.5}]},{"name":"Second\r","active":false,"points":[{"x":-20,"y":30},{"x":10,"y":-10.5},{"x":333,"y":5.555e-11}]}])-");
     }
-}
\ No newline at end of file
+
+    TEST(JsonWriter, ParallelArray)
+    {
+        vector<point> points;
+        for (int i = 0; i < 10000; i++)
+            points.push_back({ double(i), i * -0.5 });
+        auto write_point = [&](auto& s, size_t i) {
+            s.write_object([&pt = points[i]](auto s) {
+                s("x", pt.x)("y", pt.y);
+            });
+        };
+        stringstream sequential;
+        reactive_json::writer(sequential).write_array(points.size(), write_point);
+        reactive_json::thread_pool pool(4);
+        for (size_t chunk_size : { 0, 1, 7, 10000, 20000 }) {
+            stringstream parallel;
+            reactive_json::writer parallel_writer(parallel);
+            reactive_json::write_array_parallel(parallel_writer, points.size(), write_point, pool, chunk_size);
+            ASSERT_EQ(parallel.str(), sequential.str());
+        }
+        stringstream empty;
+        reactive_json::writer empty_writer(empty);
+        reactive_json::write_array_parallel(empty_writer, 0, write_point, pool);
+        ASSERT_EQ(empty.str(), "[]");
+    }
+
+    TEST(JsonWriter, AsyncSink)
+    {
+        stringstream sequential, async;
+        auto write_numbers = [](reactive_json::writer& w) {
+            w.write_array(5000, [](auto& w, size_t i) {
+                w.write_object([&](auto fields) { fields("i", double(i))("s", "some text"); });
+            });
+        };
+        {
+            reactive_json::writer w(sequential);
+            write_numbers(w);
+        }
+        {
+            reactive_json::writer w(async, reactive_json::async_options{ 100, 3 });
+            write_numbers(w);
+        }
+        ASSERT_EQ(async.str(), sequential.str());
+
+        stringstream formatted;
+        formatted.precision(3);
+        {
+            reactive_json::writer w(formatted, reactive_json::async_options{});
+            w(3.14159);
+        }
+        ASSERT_EQ(formatted.str(), "3.14");
+    }
+}
@@ -0,0 +1,289 @@
+/*
+Copyright 2021 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    https://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Generates C++ structs with reader/writer bindings from a JSON Schema document.
+// Each object schema (root, `definitions`, `$defs` and inline objects) becomes a struct bound with `REACTIVE_JSON_FIELDS`,
+// so it can be read by `reactive_json::read` with any reader and written by `reactive_json::write`.
+// Supported: `type` string/number/integer/boolean/array/object (or an array of them with "null"),
+// `properties`, `required`, `items`, `additionalProperties`, local `$ref`, `title`.
+// Properties that are not in `required` become `std::optional`.
+// All structs are declared first, and recursive references, except `std::vector` items, become `std::unique_ptr`.
+// Properties named with non-identifiers (like "$id", "@type" or "class") are bound to sanitized member names
+// ("_id", "_type", "_class"). Unsupported schemas and property names that need escaping are errors.
+// Usage: schema_codegen schema.json output.h namespace [path/to/struct_binding.h]
+
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/memory_block_reader/memory_block_reader.h"
+
+namespace
+{
+    using std::string;
+    using std::vector;
+    using std::unique_ptr;
+    using reactive_json::memory_block_reader;
+
+    struct schema;
+
+    struct property
+    {
+        string name;
+        unique_ptr<schema> type;
+    };
+
+    struct schema
+    {
+        string type;  // json type, or empty for $ref and unsupported schemas
+        bool is_nullable = false;
+        string ref;
+        string title;
+        unique_ptr<schema> items;
+        unique_ptr<schema> additional_properties;
+        vector<property> properties;
+        std::set<string> required;
+    };
+
+    unique_ptr<schema> parse_schema(memory_block_reader& json, std::map<string, unique_ptr<schema>>& definitions);
+
+    void parse_definitions(memory_block_reader& json, std::map<string, unique_ptr<schema>>& definitions)
+    {
+        json.get_object([&](auto name) {
+            definitions[name] = parse_schema(json, definitions);
+        });
+    }
+
+    unique_ptr<schema> parse_schema(memory_block_reader& json, std::map<string, unique_ptr<schema>>& definitions)
+    {
+        auto r = std::make_unique<schema>();
+        json.get_object([&](auto name) {
+            if (name == "type") {
+                if (auto type = json.try_string()) {
+                    r->type = *type;
+                } else {
+                    json.get_array([&] {
+                        auto type = json.get_string("");
+                        if (type == "null")
+                            r->is_nullable = true;
+                        else if (r->type.empty())
+                            r->type = type;
+                    });
+                }
+            } else if (name == "$ref") {
+                r->ref = json.get_string("");
+            } else if (name == "title") {
+                r->title = json.get_string("");
+            } else if (name == "items") {
+                r->items = parse_schema(json, definitions);
+            } else if (name == "additionalProperties") {
+                if (!json.try_bool())
+                    r->additional_properties = parse_schema(json, definitions);
+            } else if (name == "properties") {
+                json.get_object([&](auto name) {
+                    r->properties.push_back({ std::move(name), parse_schema(json, definitions) });
+                });
+            } else if (name == "required") {
+                json.get_array([&] {
+                    r->required.insert(json.get_string(""));
+                });
+            } else if (name == "definitions" || name == "$defs") {
+                parse_definitions(json, definitions);
+            }
+        });
+        if (r->type.empty() && !r->properties.empty())
+            r->type = "object";
+        return r;
+    }
+
+    bool is_identifier(const string& name)
+    {
+        static const std::set<string> keywords = {
+            "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+            "char", "class", "compl", "const", "constexpr", "const_cast", "continue", "decltype", "default", "delete",
+            "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+            "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq",
+            "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register", "reinterpret_cast",
+            "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct", "switch",
+            "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union",
+            "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq" };
+        if (name.empty() || (name[0] >= '0' && name[0] <= '9') || keywords.count(name))
+            return false;
+        for (char c : name) {
+            if (!(c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+                return false;
+        }
+        return true;
+    }
+
+    string to_identifier(const string& name)
+    {
+        string r;
+        for (char c : name)
+            r += (c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) ? c : '_';
+        return is_identifier(r) ? r : "_" + r;
+    }
+
+    class generator
+    {
+    public:
+        generator(std::map<string, unique_ptr<schema>>& definitions)
+            : definitions(definitions)
+        {}
+
+        // Returns the C++ type for the schema, emitting the structs it depends on.
+        string type_of(const schema& s, const string& struct_name)
+        {
+            if (!s.ref.empty()) {
+                auto slash = s.ref.rfind('/');
+                auto name = s.ref.substr(slash == string::npos ? 0 : slash + 1);
+                auto it = definitions.find(name);
+                if (s.ref.rfind("#/", 0) != 0 || it == definitions.end())
+                    fail(struct_name + ": unsupported $ref " + s.ref);
+                return type_of(*it->second, to_identifier(name));
+            }
+            if (s.type == "string") return "std::string";
+            if (s.type == "number") return "double";
+            if (s.type == "integer") return "int64_t";
+            if (s.type == "boolean") return "bool";
+            if (s.type == "array")
+                return s.items ? "std::vector<" + type_of(*s.items, struct_name + "_item") + ">" : fail(struct_name + ": array without items");
+            if (s.type == "object") {
+                if (!s.properties.empty())
+                    return emit_struct(s, struct_name);
+                if (s.additional_properties)
+                    return "std::map<std::string, " + complete_type_of(*s.additional_properties, struct_name + "_value") + ">";
+            }
+            return fail(struct_name + ": unsupported schema");
+        }
+
+        string get_output() { return declarations.str() + "\n" + output.str(); }
+
+    private:
+        // Like `type_of`, but refers to the structs being emitted (recursive schemas) through `std::unique_ptr`.
+        // `std::vector` items don't need it, as `std::vector` accepts incomplete types.
+        string complete_type_of(const schema& s, const string& struct_name)
+        {
+            auto type = type_of(s, struct_name);
+            return incomplete.count(type) ? "std::unique_ptr<" + type + ">" : type;
+        }
+
+        [[noreturn]] static string fail(const string& message)
+        {
+            std::fprintf(stderr, "%s\n", message.c_str());
+            std::exit(1);
+        }
+
+        string emit_struct(const schema& s, const string& name)
+        {
+            auto it = emitted.find(&s);
+            if (it != emitted.end())
+                return it->second;
+            emitted[&s] = name;
+            incomplete.insert(name);
+            declarations << "struct " << name << ";\n";
+            if (s.properties.size() > 32)
+                fail(name + ": more than 32 properties are not supported");
+            std::ostringstream fields, names, bindings;
+            std::set<string> members;
+            bool is_renamed = false;
+            for (auto& p : s.properties) {
+                for (char c : p.name) {
+                    if (c == '"' || c == '\\' || (unsigned char)c < ' ')
+                        fail(name + ": property name \"" + p.name + "\" needs escaping");
+                }
+                // Names that are not C++ identifiers are bound to sanitized members.
+                auto member = to_identifier(p.name);
+                while (!members.insert(member).second)
+                    member += '_';
+                is_renamed |= member != p.name;
+                auto type = complete_type_of(*p.type, name + "_" + member);
+                bool is_optional = (!s.required.count(p.name) || p.type->is_nullable) && type.rfind("std::unique_ptr<", 0) != 0;
+                fields << "    " << (is_optional ? "std::optional<" + type + ">" : type) << " " << member << "{};\n";
+                names << ", " << member;
+                bindings << (bindings.tellp() > 0 ? ",\n" : "") << "        reactive_json::field_binding<" << name
+                    << ", decltype(" << name << "::" << member << ")>{ \"" << p.name << "\", \",\\\"" << p.name
+                    << "\\\":\", &" << name << "::" << member << " }";
+            }
+            output << "struct " << name << "\n{\n" << fields.str() << "};\n";
+            if (is_renamed) {
+                output << "[[maybe_unused]] constexpr auto reactive_json_fields(const " << name << "*)\n{\n"
+                    << "    return std::make_tuple(\n" << bindings.str() << ");\n}\n";
+            } else if (!s.properties.empty()) {
+                output << "REACTIVE_JSON_FIELDS(" << name << names.str() << ")\n";
+            }
+            output << "\n";
+            incomplete.erase(name);
+            return name;
+        }
+
+        std::map<string, unique_ptr<schema>>& definitions;
+        std::map<const schema*, string> emitted;
+        std::set<string> incomplete;  // structs being emitted
+        std::ostringstream declarations;
+        std::ostringstream output;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4) {
+        std::fprintf(stderr, "Usage: schema_codegen schema.json output.h namespace [path/to/struct_binding.h]\n");
+        return 1;
+    }
+    std::ifstream file(argv[1], std::ios::binary);
+    string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!file) {
+        std::fprintf(stderr, "can't read %s\n", argv[1]);
+        return 1;
+    }
+    memory_block_reader json(data.data(), data.size());
+    std::map<string, unique_ptr<schema>> definitions;
+    auto root = parse_schema(json, definitions);
+    if (!json.success()) {
+        std::fprintf(stderr, "%s:%d: %s\n", argv[1], int(json.get_error_pos() - data.data()), json.get_error_message().c_str());
+        return 1;
+    }
+    generator gen(definitions);
+    for (auto& d : definitions) {
+        if (d.second->type == "object" && !d.second->properties.empty())
+            gen.type_of(*d.second, to_identifier(d.first));
+    }
+    if (root->type == "object" && !root->properties.empty())
+        gen.type_of(*root, to_identifier(root->title.empty() ? "root" : root->title));
+
+    string guard = argv[2];
+    guard = to_identifier(guard.substr(guard.find_last_of("/\\") + 1));
+    for (auto& c : guard)
+        c = char(std::toupper((unsigned char)c));
+    std::ofstream out(argv[2], std::ios::binary);
+    out << "// Generated by schema_codegen from " << argv[1] << ", do not edit.\n\n"
+        << "#ifndef " << guard << "\n#define " << guard << "\n\n"
+        << "#include <cstdint>\n#include <map>\n#include <memory>\n#include <optional>\n#include <string>\n#include <vector>\n\n"
+        << "#include \"" << (argc > 4 ? argv[4] : "serialization/struct_binding.h") << "\"\n\n"
+        << "namespace " << argv[3] << "\n{\n"
+        << gen.get_output()
+        << "}\n\n#endif  // " << guard << "\n";
+    if (!out) {
+        std::fprintf(stderr, "can't write %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <sstream>
+#include <memory>
+#include "schema_codegen_test_schema.h"
+#include "../src/memory_block_reader/memory_block_reader.h"
+#include "../src/istream_reader/istream_reader.h"
+#include "gunit.h"
+
+namespace
+{
+    const char* text =
+        R"-({"name":"main","version":3,"items":[{"id":1,"price":2.5,"available":true,"dimensions":[1,2]},{"id":2,"price":10}],)-"
+        R"-("tags":{"a":"x"},"owner":{"id":7},"not-an-identifier":"n","$id":"urn:x","@type":"t","class":2,"tree":{"value":1,"next":{"value":2}},)-"
+        R"-("sections":[{"title":"s","entries":[{"name":"e","sections":[{"title":"t"}]}]}]})-";
+
+    TEST(SchemaCodegen, GeneratedTypes)
+    {
+        generated::catalog catalog;
+        reactive_json::memory_block_reader json(text);
+        reactive_json::read(json, catalog);
+        ASSERT_TRUE(json.success());
+        ASSERT_EQ(catalog.name, "main");
+        ASSERT_EQ(*catalog.version, 3);
+        ASSERT_EQ(catalog.items.size(), 2);
+        ASSERT_EQ(catalog.items[0].dimensions->size(), 2);
+        ASSERT_FALSE(catalog.items[1].available.has_value());
+        ASSERT_EQ(catalog.tags->at("a"), "x");
+        ASSERT_EQ(catalog.owner->id, 7);
+        ASSERT_FALSE(catalog.owner->email.has_value());
+        ASSERT_EQ(*catalog.not_an_identifier, "n");
+        ASSERT_EQ(*catalog._id, "urn:x");
+        ASSERT_EQ(*catalog._type, "t");
+        ASSERT_EQ(*catalog._class, 2);
+        ASSERT_EQ(catalog.tree->next->value, 2);
+        ASSERT_TRUE(catalog.tree->next->next == nullptr);
+        ASSERT_EQ(*(*catalog.sections)[0].entries->at(0).sections->at(0).title, "t");
+
+        std::ostringstream out;
+        reactive_json::writer w(out);
+        reactive_json::write(w, catalog);
+        ASSERT_EQ(out.str(), text);
+
+        generated::catalog stream_catalog;
+        reactive_json::istream_reader stream_json(std::make_unique<std::stringstream>(text));
+        reactive_json::read(stream_json, stream_catalog);
+        ASSERT_TRUE(stream_json.success());
+        ASSERT_EQ(stream_catalog.items[1].price, 10);
+    }
+
+    TEST(SchemaCodegen, RequiredFields)
+    {
+        generated::catalog catalog;
+        reactive_json::memory_block_reader json(R"-({"name":"main"})-");
+        reactive_json::read(json, catalog);
+        ASSERT_EQ(json.get_error_message(), "missing field items");
+    }
+}